@@ -0,0 +1,318 @@
+/***************************************************************************
+ *   Copyright (C) 2021 by Tom Schouten, tom@zwizwa.be                     *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+/*
+  Loopback stand-in for the pdap firmware, for testing the pdap
+  driver without a probe.  It creates a pty, prints the name of the
+  slave side and then speaks both the text and the binary protocol
+  on the master side.  Behind it sits a fake SW-DP with an AHB-AP
+  and 64 KiB of RAM at 0x20000000, including posted AP reads and TAR
+  auto increment, so mdw/mww/load_image work.
+
+  To compile run:
+  gcc -Wall -std=gnu99 -o pdap_loopback pdap_loopback.c
+
+  Usage example:
+  ./pdap_loopback &
+  PDAP_TTY=/dev/pts/N openocd -c "adapter driver pdap" -c "transport select swd" ...
+  PDAP_TTY=/dev/pts/N PDAP_MODE=binary openocd ...
+
+  With --enable-pdap, "make check" builds it and runs
+  pdap_loopback_test.sh, which does the following once per mode
+  against a fresh loopback:
+
+  openocd -c "adapter driver pdap" -c "transport select swd" \
+	-c "swd newdap chip cpu -enable" \
+	-c "dap create chip.dap -chain-position chip.cpu" \
+	-c "target create chip.ram mem_ap -dap chip.dap -ap-num 0" \
+	-c init -c "mww 0x20000000 0x12345678 4" \
+	-c "mdw 0x20000000 4" -c shutdown
+
+  mdw must print 0x12345678 four times.
+*/
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define REC_SIZE 8
+
+enum { OP_RD = 1, OP_RD_DROP, OP_WR, OP_IDLE, OP_SEQ, OP_SRST, OP_SYNC,
+       OP_RD_BLOCK, OP_WR_BLOCK };
+enum { RSP_VAL = 1, RSP_ERR, RSP_SYNC, RSP_BLOCK };
+
+/* Fake target. */
+#define RAM_BASE 0x20000000
+#define RAM_SIZE 0x10000
+static uint32_t ram[RAM_SIZE / 4];
+static uint32_t ctrl_stat, select_reg, csw, tar, rdbuff;
+
+static uint32_t *ram_word(uint32_t addr)
+{
+	if (addr < RAM_BASE || addr >= RAM_BASE + RAM_SIZE)
+		return NULL;
+	return &ram[(addr - RAM_BASE) / 4];
+}
+
+static void tar_inc(void)
+{
+	if (((csw >> 4) & 3) == 1)
+		tar += 4;
+}
+
+static uint32_t ap_read(unsigned reg)
+{
+	unsigned bank = (select_reg >> 4) & 0xF;
+	uint32_t *w;
+	switch ((bank << 4) | reg) {
+	case 0x00: return csw;
+	case 0x04: return tar;
+	case 0x0C:
+		w = ram_word(tar);
+		tar_inc();
+		return w ? *w : 0;
+	case 0xF4: return 0;
+	case 0xF8: return 0xFFFFFFFF;       /* no ROM table */
+	case 0xFC: return 0x24770011;       /* AHB-AP */
+	default:   return 0;
+	}
+}
+
+static void ap_write(unsigned reg, uint32_t val)
+{
+	unsigned bank = (select_reg >> 4) & 0xF;
+	uint32_t *w;
+	switch ((bank << 4) | reg) {
+	case 0x00: csw = val; break;
+	case 0x04: tar = val; break;
+	case 0x0C:
+		w = ram_word(tar);
+		if (w)
+			*w = val;
+		tar_inc();
+		break;
+	}
+}
+
+/* Raw SWD semantics: AP reads are posted, the result arrives with
+   the next AP read or with a RDBUFF read. */
+static uint32_t swd_rd(uint8_t cmd)
+{
+	unsigned reg = (cmd >> 1) & 0xC;
+	if (cmd & 0x02) {
+		uint32_t prev = rdbuff;
+		rdbuff = ap_read(reg);
+		return prev;
+	}
+	switch (reg) {
+	case 0x0: return 0x0BB11477;        /* IDCODE */
+	case 0x4: return ctrl_stat;
+	case 0xC: return rdbuff;
+	default:  return 0;
+	}
+}
+
+static void swd_wr(uint8_t cmd, uint32_t val)
+{
+	unsigned reg = (cmd >> 1) & 0xC;
+	if (cmd & 0x02) {
+		ap_write(reg, val);
+		return;
+	}
+	switch (reg) {
+	case 0x4:
+		/* Acknowledge power up requests. */
+		ctrl_stat = (val & 0x50000000) | ((val & 0x50000000) << 1);
+		break;
+	case 0x8:
+		select_reg = val;
+		break;
+	}
+}
+
+/* Text protocol: a small stack machine. */
+static FILE *in, *out;
+static int echo = 1, base = 10, armed;
+static uint32_t stack[16];
+static int sp;
+
+static void push(uint32_t v)
+{
+	if (sp < 16)
+		stack[sp++] = v;
+}
+
+static uint32_t pop(void)
+{
+	return sp ? stack[--sp] : 0;
+}
+
+static void word(const char *w)
+{
+	char *end;
+	uint32_t v = strtoul(w, &end, base);
+	if (*w && !*end) {
+		push(v);
+	} else if (!strcmp(w, "echo")) {
+		echo = pop();
+	} else if (!strcmp(w, "hex")) {
+		base = 16;
+	} else if (!strcmp(w, "sync")) {
+		fprintf(out, "sync %x\r\n", pop());
+	} else if (!strcmp(w, "rd")) {
+		push(swd_rd(pop()));
+	} else if (!strcmp(w, "p")) {
+		fprintf(out, "%x\r\n", pop());
+	} else if (!strcmp(w, "drop") || !strcmp(w, "idle") || !strcmp(w, "srst")) {
+		pop();
+	} else if (!strcmp(w, "wr")) {
+		uint8_t cmd = pop();
+		swd_wr(cmd, pop());
+	} else if (!strcmp(w, "line_reset") || !strcmp(w, "jtag_to_swd") ||
+		   !strcmp(w, "swd_to_jtag")) {
+		/* nop */
+	} else if (!strcmp(w, "binary")) {
+		fprintf(out, "binary 2\r\n");
+		armed = 1;
+	} else {
+		fprintf(out, "# unknown word '%s'\r\n", w);
+	}
+}
+
+static int text_loop(void)
+{
+	char w[64];
+	int n = 0, c;
+	while (EOF != (c = fgetc(in))) {
+		if (echo)
+			fputc(c, out);
+		if (c > ' ' && n < (int)sizeof(w) - 1) {
+			w[n++] = c;
+			continue;
+		}
+		if (n) {
+			w[n] = 0;
+			n = 0;
+			int sync = !strcmp(w, "sync");
+			word(w);
+			/* An armed switch takes effect after the next
+			   sync reply. */
+			if (sync && armed) {
+				fflush(out);
+				return 1;
+			}
+		}
+		if (c == '\n')
+			fflush(out);
+	}
+	return 0;
+}
+
+static void reply(uint8_t type, uint8_t ack, const uint8_t *req, uint32_t val)
+{
+	uint8_t rec[REC_SIZE] = { type, ack, req[2], req[3],
+		val, val >> 8, val >> 16, val >> 24 };
+	fwrite(rec, sizeof(rec), 1, out);
+}
+
+static uint32_t le32(const uint8_t *b)
+{
+	return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+/* Block data: two words per record, padded. */
+static void block_rd(const uint8_t *req, unsigned count)
+{
+	reply(RSP_BLOCK, 1, req, count);
+	for (unsigned i = 0; i < count; i += 2) {
+		uint32_t w0 = swd_rd(req[1]);
+		uint32_t w1 = i + 1 < count ? swd_rd(req[1]) : 0;
+		uint8_t rec[REC_SIZE] = { w0, w0 >> 8, w0 >> 16, w0 >> 24,
+			w1, w1 >> 8, w1 >> 16, w1 >> 24 };
+		fwrite(rec, sizeof(rec), 1, out);
+	}
+}
+
+static void block_wr(const uint8_t *req, unsigned count)
+{
+	uint8_t rec[REC_SIZE];
+	for (unsigned i = 0; i < count; i += 2) {
+		if (1 != fread(rec, sizeof(rec), 1, in))
+			return;
+		swd_wr(req[1], le32(rec));
+		if (i + 1 < count)
+			swd_wr(req[1], le32(rec + 4));
+	}
+}
+
+static void binary_loop(void)
+{
+	uint8_t req[REC_SIZE];
+	while (1 == fread(req, sizeof(req), 1, in)) {
+		uint32_t val = le32(req + 4);
+		switch (req[0]) {
+		case OP_RD:
+			reply(RSP_VAL, 1, req, swd_rd(req[1]));
+			break;
+		case OP_RD_DROP:
+			swd_rd(req[1]);
+			break;
+		case OP_WR:
+			swd_wr(req[1], val);
+			break;
+		case OP_RD_BLOCK:
+			block_rd(req, val & 0xFFFF);
+			break;
+		case OP_WR_BLOCK:
+			block_wr(req, val & 0xFFFF);
+			break;
+		case OP_SYNC:
+			reply(RSP_SYNC, 0, req, 0);
+			fflush(out);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+int main(void)
+{
+	int fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if (fd < 0 || grantpt(fd) || unlockpt(fd)) {
+		perror("pty");
+		return 1;
+	}
+	struct termios tio;
+	tcgetattr(fd, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(fd, TCSANOW, &tio);
+
+	printf("%s\n", ptsname(fd));
+	fflush(stdout);
+
+	in = fdopen(fd, "r");
+	out = fdopen(dup(fd), "w");
+	if (text_loop())
+		binary_loop();
+	return 0;
+}
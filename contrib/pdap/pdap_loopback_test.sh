@@ -0,0 +1,47 @@
+#!/bin/sh
+# Run by "make check" when the pdap driver is built: start pdap_loopback,
+# write words to its RAM through a mem_ap target and read them back, once
+# in text and once in binary mode.
+
+OPENOCD=${OPENOCD:-./src/openocd}
+LOOPBACK=${LOOPBACK:-./contrib/pdap/pdap_loopback}
+EXPECTED="0x20000000: 12345678 12345678 12345678 12345678"
+
+tmp=$(mktemp -d) || exit 99
+trap 'rm -rf "$tmp"' EXIT
+status=0
+
+for mode in text binary; do
+	$LOOPBACK > "$tmp/tty" &
+	pid=$!
+	while [ ! -s "$tmp/tty" ] && kill -0 $pid 2>/dev/null; do
+		sleep 1
+	done
+	tty=$(head -n 1 "$tmp/tty")
+	if [ -z "$tty" ]; then
+		echo "pdap_loopback did not start"
+		exit 99
+	fi
+
+	PDAP_TTY=$tty PDAP_MODE=$mode $OPENOCD \
+		-c "adapter driver pdap" -c "transport select swd" \
+		-c "swd newdap chip cpu -enable" \
+		-c "dap create chip.dap -chain-position chip.cpu" \
+		-c "target create chip.ram mem_ap -dap chip.dap -ap-num 0" \
+		-c init -c "mww 0x20000000 0x12345678 4" \
+		-c "mdw 0x20000000 4" -c shutdown > "$tmp/log" 2>&1
+
+	kill $pid 2>/dev/null
+	wait $pid 2>/dev/null
+
+	if grep -q "$EXPECTED" "$tmp/log"; then
+		echo "pdap $mode mode: ok"
+	else
+		echo "pdap $mode mode: FAILED"
+		cat "$tmp/log"
+		status=1
+	fi
+	rm -f "$tmp/tty"
+done
+
+exit $status
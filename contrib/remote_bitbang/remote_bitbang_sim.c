@@ -0,0 +1,361 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+/*
+  Reference server for the remote_bitbang driver, for testing without
+  hardware.  It speaks both protocol v1 (one character per request) and
+  v2 (packed JTAG vectors and SWD transfers, see
+  doc/manual/jtag/drivers/remote_bitbang.txt).
+
+  Behind it sits a simulated target:
+  - JTAG: one TAP with a 4 bit IR, IDCODE (0xE, the reset instruction)
+    and BYPASS (0xF).
+  - SWD (v2 only): a SW-DP with an AHB-AP and 64 KiB of RAM at
+    0x20000000, with posted AP reads and TAR auto increment.
+
+  To compile run:
+  gcc -Wall -std=gnu99 -o remote_bitbang_sim remote_bitbang_sim.c
+
+  Usage example:
+  ./remote_bitbang_sim 3335 &
+  openocd -c "adapter driver remote_bitbang; remote_bitbang_port 3335" \
+	  -c "transport select jtag; jtag newtap sim cpu -irlen 4 -expected-id 0x4ba00477" \
+	  -c "init; scan_chain; shutdown"
+
+  Pass -v1 to behave like a server that doesn't know about v2.
+*/
+
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define IDCODE 0x4BA00477
+#define DPIDR  0x0BB11477
+
+static int v1_only;
+static FILE *in, *out;
+
+/* JTAG TAP */
+enum {
+	RESET, IDLE,
+	DRSELECT, DRCAPTURE, DRSHIFT, DREXIT1, DRPAUSE, DREXIT2, DRUPDATE,
+	IRSELECT, IRCAPTURE, IRSHIFT, IREXIT1, IRPAUSE, IREXIT2, IRUPDATE,
+};
+
+/* next state for tms = 0, tms = 1 */
+static const int tap_next[16][2] = {
+	[RESET]     = { IDLE, RESET },
+	[IDLE]      = { IDLE, DRSELECT },
+	[DRSELECT]  = { DRCAPTURE, IRSELECT },
+	[DRCAPTURE] = { DRSHIFT, DREXIT1 },
+	[DRSHIFT]   = { DRSHIFT, DREXIT1 },
+	[DREXIT1]   = { DRPAUSE, DRUPDATE },
+	[DRPAUSE]   = { DRPAUSE, DREXIT2 },
+	[DREXIT2]   = { DRSHIFT, DRUPDATE },
+	[DRUPDATE]  = { IDLE, DRSELECT },
+	[IRSELECT]  = { IRCAPTURE, RESET },
+	[IRCAPTURE] = { IRSHIFT, IREXIT1 },
+	[IRSHIFT]   = { IRSHIFT, IREXIT1 },
+	[IREXIT1]   = { IRPAUSE, IRUPDATE },
+	[IRPAUSE]   = { IRPAUSE, IREXIT2 },
+	[IREXIT2]   = { IRSHIFT, IRUPDATE },
+	[IRUPDATE]  = { IDLE, DRSELECT },
+};
+
+static int tap_state = RESET;
+static uint32_t ir = 0xE, shift;
+static int shift_len;
+static int tck, tms, tdi;
+
+static int tdo(void)
+{
+	if (tap_state == DRSHIFT || tap_state == IRSHIFT)
+		return shift & 1;
+	return 0;
+}
+
+static void tap_reset(void)
+{
+	tap_state = RESET;
+	ir = 0xE;
+}
+
+static void tap_clock(void)
+{
+	switch (tap_state) {
+	case DRCAPTURE:
+		shift = ir == 0xE ? IDCODE : 0;
+		shift_len = ir == 0xE ? 32 : 1;
+		break;
+	case IRCAPTURE:
+		shift = 0x1;
+		shift_len = 4;
+		break;
+	case DRSHIFT:
+	case IRSHIFT:
+		shift = (shift >> 1) | ((uint32_t)tdi << (shift_len - 1));
+		break;
+	default:
+		break;
+	}
+	tap_state = tap_next[tap_state][tms];
+	if (tap_state == IRUPDATE)
+		ir = shift & 0xF;
+	if (tap_state == RESET)
+		ir = 0xE;
+}
+
+static void pins(int new_tck, int new_tms, int new_tdi)
+{
+	tms = new_tms;
+	tdi = new_tdi;
+	if (new_tck && !tck)
+		tap_clock();
+	tck = new_tck;
+}
+
+/* SW-DP / AHB-AP */
+#define RAM_BASE 0x20000000
+#define RAM_SIZE 0x10000
+static uint32_t ram[RAM_SIZE / 4];
+static uint32_t ctrl_stat, select_reg, csw, tar, rdbuff;
+
+static uint32_t *ram_word(uint32_t addr)
+{
+	if (addr < RAM_BASE || addr >= RAM_BASE + RAM_SIZE)
+		return NULL;
+	return &ram[(addr - RAM_BASE) / 4];
+}
+
+static void tar_inc(void)
+{
+	if (((csw >> 4) & 3) == 1)
+		tar += 4;
+}
+
+static uint32_t ap_read(unsigned reg)
+{
+	unsigned bank = (select_reg >> 4) & 0xF;
+	uint32_t *w;
+	switch ((bank << 4) | reg) {
+	case 0x00: return csw;
+	case 0x04: return tar;
+	case 0x0C:
+		w = ram_word(tar);
+		tar_inc();
+		return w ? *w : 0;
+	case 0xF8: return 0xFFFFFFFF;       /* no ROM table */
+	case 0xFC: return 0x24770011;       /* AHB-AP */
+	default:   return 0;
+	}
+}
+
+static void ap_write(unsigned reg, uint32_t val)
+{
+	unsigned bank = (select_reg >> 4) & 0xF;
+	uint32_t *w;
+	switch ((bank << 4) | reg) {
+	case 0x00: csw = val; break;
+	case 0x04: tar = val; break;
+	case 0x0C:
+		w = ram_word(tar);
+		if (w)
+			*w = val;
+		tar_inc();
+		break;
+	}
+}
+
+/* Raw SWD semantics: AP reads are posted. */
+static uint32_t swd_read(uint8_t cmd)
+{
+	unsigned reg = (cmd >> 1) & 0xC;
+	if (cmd & 0x02) {
+		uint32_t prev = rdbuff;
+		rdbuff = ap_read(reg);
+		return prev;
+	}
+	switch (reg) {
+	case 0x0: return DPIDR;
+	case 0x4: return ctrl_stat;
+	case 0xC: return rdbuff;
+	default:  return 0;
+	}
+}
+
+static void swd_write(uint8_t cmd, uint32_t val)
+{
+	unsigned reg = (cmd >> 1) & 0xC;
+	if (cmd & 0x02) {
+		ap_write(reg, val);
+		return;
+	}
+	switch (reg) {
+	case 0x4:
+		/* Acknowledge power up requests. */
+		ctrl_stat = (val & 0x50000000) | ((val & 0x50000000) << 1);
+		break;
+	case 0x8:
+		select_reg = val;
+		break;
+	}
+}
+
+static int get_bytes(void *buf, size_t len)
+{
+	return len == 0 || fread(buf, len, 1, in) == 1;
+}
+
+static uint16_t le16(const uint8_t *b)
+{
+	return b[0] | (b[1] << 8);
+}
+
+static uint32_t le32(const uint8_t *b)
+{
+	return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+/* 'J' flags nbits(le16) tms[] tdi[] -> tdo[] if flags & 1 */
+static int jtag_vector(void)
+{
+	static uint8_t vtms[8192], vtdi[8192], vtdo[8192];
+	uint8_t hdr[3];
+	if (!get_bytes(hdr, sizeof(hdr)))
+		return 0;
+	unsigned bits = le16(hdr + 1);
+	unsigned bytes = (bits + 7) / 8;
+	if (!get_bytes(vtms, bytes) || !get_bytes(vtdi, bytes))
+		return 0;
+	memset(vtdo, 0, bytes);
+	for (unsigned i = 0; i < bits; i++) {
+		int bms = (vtms[i / 8] >> (i % 8)) & 1;
+		int bdi = (vtdi[i / 8] >> (i % 8)) & 1;
+		pins(0, bms, bdi);
+		vtdo[i / 8] |= tdo() << (i % 8);
+		pins(1, bms, bdi);
+	}
+	pins(0, tms, tdi);
+	if (hdr[0] & 1)
+		fwrite(vtdo, bytes, 1, out);
+	return 1;
+}
+
+/* 'D' nbits(le16) bits[] */
+static int swd_sequence(void)
+{
+	uint8_t hdr[2], bits[8192];
+	if (!get_bytes(hdr, sizeof(hdr)))
+		return 0;
+	return get_bytes(bits, (le16(hdr) + 7) / 8);
+}
+
+/* 'W' cmd data(le32) idle(le16) -> ack [data(le32) parity] */
+static int swd_transfer(void)
+{
+	uint8_t req[7];
+	if (!get_bytes(req, sizeof(req)))
+		return 0;
+	uint8_t cmd = req[0];
+	if (cmd & 0x04) {
+		uint32_t val = swd_read(cmd);
+		uint8_t rsp[6] = { 1, val, val >> 8, val >> 16, val >> 24,
+			__builtin_parity(val) };
+		fwrite(rsp, sizeof(rsp), 1, out);
+	} else {
+		swd_write(cmd, le32(req + 1));
+		fputc(1, out);
+	}
+	return 1;
+}
+
+static void serve(void)
+{
+	int c;
+	while ((c = fgetc(in)) != EOF) {
+		if (c >= '0' && c <= '7') {
+			pins(!!(c & 4), !!(c & 2), c & 1);
+		} else if (c == 'R') {
+			fputc('0' + tdo(), out);
+			fflush(out);
+		} else if (c >= 'r' && c <= 'u') {
+			if ((c - 'r') & 2)
+				tap_reset();
+		} else if (c == 'B' || c == 'b') {
+			/* no LED */
+		} else if (c == 'Q') {
+			break;
+		} else if (c == 'V' && !v1_only) {
+			fputc('2', out);
+		} else if (c == 'J' && !v1_only) {
+			if (!jtag_vector())
+				break;
+			fflush(out);
+		} else if (c == 'D' && !v1_only) {
+			if (!swd_sequence())
+				break;
+		} else if (c == 'W' && !v1_only) {
+			if (!swd_transfer())
+				break;
+			fflush(out);
+		} else {
+			fprintf(stderr, "Unknown command '%c' received\n", c);
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int port = 3335;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-v1"))
+			v1_only = 1;
+		else
+			port = atoi(argv[i]);
+	}
+
+	int s = socket(AF_INET, SOCK_STREAM, 0);
+	int one = 1;
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) || listen(s, 1)) {
+		perror("listen");
+		return 1;
+	}
+
+	for (;;) {
+		int fd = accept(s, NULL, NULL);
+		if (fd < 0) {
+			perror("accept");
+			return 1;
+		}
+		in = fdopen(fd, "r");
+		out = fdopen(dup(fd), "w");
+		tap_reset();
+		serve();
+		fclose(in);
+		fclose(out);
+	}
+	return 0;
+}
@@ -302,12 +302,43 @@ int get_flash_bank_by_addr(struct target *target,
 	return ERROR_OK;
 }
 
+/* Bytes read per transfer by the memory based blank check. Reads span
+ * sector boundaries, so small sectors don't mean small transfers. */
+#define FLASH_BLANK_CHECK_CHUNK	(64 * 1024)
+
+/* Check whether all of buffer holds erased_value, 64 bytes at a time in
+ * the common case; the inner loop is simple enough to be vectorized. */
+static bool flash_buffer_is_erased(const uint8_t *buffer, uint32_t count,
+	uint8_t erased_value)
+{
+	uint64_t pattern;
+	uint32_t i = 0;
+
+	memset(&pattern, erased_value, sizeof(pattern));
+
+	for (; i + 64 <= count; i += 64) {
+		uint64_t diff = 0;
+		for (unsigned int j = 0; j < 64; j += sizeof(uint64_t)) {
+			uint64_t word;
+			memcpy(&word, buffer + i + j, sizeof(word));
+			diff |= word ^ pattern;
+		}
+		if (diff)
+			return false;
+	}
+
+	for (; i < count; i++) {
+		if (buffer[i] != erased_value)
+			return false;
+	}
+
+	return true;
+}
+
 static int default_flash_mem_blank_check(struct flash_bank *bank)
 {
 	struct target *target = bank->target;
-	const int buffer_size = 1024;
 	int i;
-	uint32_t nBytes;
 	int retval = ERROR_OK;
 
 	if (bank->target->state != TARGET_HALTED) {
@@ -315,32 +346,42 @@ static int default_flash_mem_blank_check(struct flash_bank *bank)
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
-	uint8_t *buffer = malloc(buffer_size);
+	uint8_t *buffer = malloc(FLASH_BLANK_CHECK_CHUNK);
+	if (buffer == NULL) {
+		LOG_ERROR("Out of memory for blank check buffer");
+		return ERROR_FAIL;
+	}
+
+	/* bank offsets of the data in buffer */
+	uint32_t buffer_start = 0;
+	uint32_t buffer_len = 0;
 
 	for (i = 0; i < bank->num_sectors; i++) {
-		uint32_t j;
-		bank->sectors[i].is_erased = 1;
+		uint32_t offset = bank->sectors[i].offset;
+		uint32_t end = offset + bank->sectors[i].size;
 
-		for (j = 0; j < bank->sectors[i].size; j += buffer_size) {
-			uint32_t chunk;
-			chunk = buffer_size;
-			if (chunk > (bank->sectors[i].size - j))
-				chunk = (bank->sectors[i].size - j);
-
-			retval = target_read_memory(target,
-					bank->base + bank->sectors[i].offset + j,
-					4,
-					chunk/4,
-					buffer);
-			if (retval != ERROR_OK)
-				goto done;
+		bank->sectors[i].is_erased = 1;
 
-			for (nBytes = 0; nBytes < chunk; nBytes++) {
-				if (buffer[nBytes] != bank->erased_value) {
-					bank->sectors[i].is_erased = 0;
-					break;
+		while (offset < end) {
+			if (offset < buffer_start || offset >= buffer_start + buffer_len) {
+				buffer_start = offset;
+				buffer_len = MIN(FLASH_BLANK_CHECK_CHUNK, MAX(bank->size, end) - offset);
+				retval = target_read_buffer(target, bank->base + offset,
+						buffer_len, buffer);
+				if (retval != ERROR_OK) {
+					bank->sectors[i].is_erased = -1;
+					goto done;
 				}
 			}
+
+			uint32_t count = MIN(end, buffer_start + buffer_len) - offset;
+			if (!flash_buffer_is_erased(buffer + offset - buffer_start, count,
+					bank->erased_value)) {
+				/* no need to look at the rest of the sector */
+				bank->sectors[i].is_erased = 0;
+				break;
+			}
+			offset += count;
 		}
 	}
 
@@ -696,73 +737,202 @@ static bool flash_write_check_gap(struct flash_bank *bank,
 }
 
 
-int flash_write_unlock(struct target *target, struct image *image,
-	uint32_t *written, int erase, bool unlock)
+/* Unlock, erase and program one run of image data. */
+static int flash_write_run(struct target *target, struct flash_bank *bank,
+	uint8_t *buffer, target_addr_t address, uint32_t size, int erase, bool unlock)
 {
 	int retval = ERROR_OK;
 
-	int section;
-	uint32_t section_offset;
-	struct flash_bank *c;
-	int *padding;
+	if (unlock)
+		retval = flash_unlock_address_range(target, address, size);
+	if (retval == ERROR_OK) {
+		if (erase) {
+			/* calculate and erase sectors */
+			retval = flash_erase_address_range(target,
+					true, address, size);
+		}
+	}
 
-	section = 0;
-	section_offset = 0;
+	if (retval == ERROR_OK) {
+		/* write flash sectors */
+		retval = flash_driver_write(bank, buffer, address - bank->base, size);
+	}
 
-	if (written)
-		*written = 0;
+	return retval;
+}
 
-	if (erase) {
-		/* assume all sectors need erasing - stops any problems
-		 * when flash_write is called multiple times */
+/* Check whether flash at the given bank offset already holds data. */
+static int flash_range_unchanged(struct flash_bank *bank, uint8_t *data,
+	uint32_t offset, uint32_t count, bool *unchanged)
+{
+	int retval;
 
-		flash_set_dirty();
+	if (bank->driver->read == default_flash_read) {
+		/* memory mapped; the target can checksum it, with an on-chip
+		 * algorithm if it has one */
+		uint32_t target_crc, image_crc;
+
+		retval = target_checksum_memory(bank->target, bank->base + offset,
+				count, &target_crc);
+		if (retval != ERROR_OK)
+			return retval;
+
+		retval = image_calculate_checksum(data, count, &image_crc);
+		if (retval != ERROR_OK)
+			return retval;
+
+		*unchanged = target_crc == image_crc;
+		return ERROR_OK;
 	}
 
-	/* allocate padding array */
-	padding = calloc(image->num_sections, sizeof(*padding));
+	uint8_t *contents = malloc(count);
+	if (contents == NULL) {
+		LOG_ERROR("Out of memory for flash compare buffer");
+		return ERROR_FAIL;
+	}
 
-	/* This fn requires all sections to be in ascending order of addresses,
-	 * whereas an image can have sections out of order. */
-	struct imagesection **sections = malloc(sizeof(struct imagesection *) *
-			image->num_sections);
-	int i;
-	for (i = 0; i < image->num_sections; i++)
-		sections[i] = &image->sections[i];
+	retval = flash_driver_read(bank, contents, offset, count);
+	if (retval == ERROR_OK)
+		*unchanged = memcmp(contents, data, count) == 0;
 
-	qsort(sections, image->num_sections, sizeof(struct imagesection *),
-		compare_section);
+	free(contents);
+	return retval;
+}
 
-	/* loop until we reach end of the image */
-	while (section < image->num_sections) {
-		uint32_t buffer_idx;
-		uint8_t *buffer;
+/* Like flash_write_run(), but only for the sectors whose contents differ
+ * from the image. Consecutive differing sectors are still handled as one
+ * run so the driver can program them in a single call.
+ */
+static int flash_write_run_incremental(struct target *target, struct flash_bank *bank,
+	uint8_t *buffer, target_addr_t run_address, uint32_t run_size, int erase, bool unlock,
+	uint32_t *programmed, unsigned int *checked, unsigned int *skipped)
+{
+	uint32_t run_start = run_address - bank->base;
+	uint32_t run_end = run_start + run_size;
+	/* bank offsets of the pending range of differing sectors */
+	uint32_t dirty_start = 0, dirty_end = 0;
+	int retval;
+
+	*programmed = 0;
+
+	for (int sector = 0; sector < bank->num_sectors; sector++) {
+		uint32_t start = MAX(bank->sectors[sector].offset, run_start);
+		uint32_t end = MIN(bank->sectors[sector].offset + bank->sectors[sector].size,
+				run_end);
+		if (start >= end)
+			continue;
+
+		bool unchanged;
+		retval = flash_range_unchanged(bank, buffer + start - run_start,
+				start, end - start, &unchanged);
+		if (retval != ERROR_OK)
+			return retval;
+
+		(*checked)++;
+		if (!unchanged) {
+			LOG_DEBUG("sector %d differs from image", sector);
+			if (dirty_end == dirty_start)
+				dirty_start = start;
+			dirty_end = end;
+			continue;
+		}
+
+		(*skipped)++;
+		if (dirty_end == dirty_start)
+			continue;
+
+		retval = flash_write_run(target, bank, buffer + dirty_start - run_start,
+				bank->base + dirty_start, dirty_end - dirty_start, erase, unlock);
+		if (retval != ERROR_OK)
+			return retval;
+
+		*programmed += dirty_end - dirty_start;
+		dirty_start = dirty_end = 0;
+	}
+
+	if (dirty_end == dirty_start)
+		return ERROR_OK;
+
+	retval = flash_write_run(target, bank, buffer + dirty_start - run_start,
+			bank->base + dirty_start, dirty_end - dirty_start, erase, unlock);
+	if (retval == ERROR_OK)
+		*programmed += dirty_end - dirty_start;
+
+	return retval;
+}
+
+/* One run of image data, i.e. consecutive sections in the same bank joined
+ * by padding, which is handed to the flash driver in one piece. */
+struct flash_write_run {
+	struct flash_bank *bank;
+	target_addr_t address;
+	uint32_t size;
+	uint8_t *buffer;
+	/* bytes of buffer prepared so far */
+	uint32_t filled;
+	/* image position the next bytes are read from */
+	int section;
+	uint32_t section_offset;
+};
+
+/* Image state shared by the planning and filling of runs. */
+struct flash_write_image {
+	struct image *image;
+	/* sections in ascending order of addresses */
+	struct imagesection **sections;
+	/* padding to add after each sorted section */
+	int *padding;
+	/* run prepared while the previous one is being programmed */
+	struct flash_write_run *prefetch;
+	int prefetch_retval;
+};
+
+/* Bytes of image data read per call while the target is busy. */
+#define FLASH_WRITE_PREFETCH_CHUNK	(16 * 1024)
+
+/* Work out where the next run starts and ends, starting from the image
+ * position given by section and section_offset, and advance that past the run.
+ * No image data is read. Sets run->size to zero at the end of the image.
+ */
+static int flash_write_plan_run(struct target *target, struct flash_write_image *fwi,
+	int *section, uint32_t *section_offset, int erase, bool unlock,
+	struct flash_write_run *run)
+{
+	struct image *image = fwi->image;
+	struct imagesection **sections = fwi->sections;
+	int *padding = fwi->padding;
+	struct flash_bank *c;
+	int retval;
+
+	memset(run, 0, sizeof(*run));
+
+	while (*section < image->num_sections) {
 		int section_last;
-		target_addr_t run_address = sections[section]->base_address + section_offset;
-		uint32_t run_size = sections[section]->size - section_offset;
+		target_addr_t run_address = sections[*section]->base_address + *section_offset;
+		uint32_t run_size = sections[*section]->size - *section_offset;
 		int pad_bytes = 0;
 
-		if (sections[section]->size ==  0) {
-			LOG_WARNING("empty section %d", section);
-			section++;
-			section_offset = 0;
+		if (sections[*section]->size ==  0) {
+			LOG_WARNING("empty section %d", *section);
+			(*section)++;
+			*section_offset = 0;
 			continue;
 		}
 
 		/* find the corresponding flash bank */
 		retval = get_flash_bank_by_addr(target, run_address, false, &c);
 		if (retval != ERROR_OK)
-			goto done;
+			return retval;
 		if (c == NULL) {
 			LOG_WARNING("no flash bank found for address " TARGET_ADDR_FMT, run_address);
-			section++;	/* and skip it */
-			section_offset = 0;
+			(*section)++;	/* and skip it */
+			*section_offset = 0;
 			continue;
 		}
 
 		/* collect consecutive sections which fall into the same bank */
-		section_last = section;
-		padding[section] = 0;
+		section_last = *section;
+		padding[*section] = 0;
 		while ((run_address + run_size - 1 < c->base + c->size - 1) &&
 				(section_last + 1 < image->num_sections)) {
 			/* sections are sorted */
@@ -782,8 +952,7 @@ int flash_write_unlock(struct target *target, struct image *image,
 					" overlaps section ending at " TARGET_ADDR_FMT,
 					next_section_base, run_next_addr);
 				LOG_ERROR("Flash write aborted.");
-				retval = ERROR_FAIL;
-				goto done;
+				return ERROR_FAIL;
 			}
 
 			pad_bytes = next_section_base - run_next_addr;
@@ -865,91 +1034,224 @@ int flash_write_unlock(struct target *target, struct image *image,
 		}
 
 		/* allocate buffer */
-		buffer = malloc(run_size);
-		if (buffer == NULL) {
+		run->buffer = malloc(run_size);
+		if (run->buffer == NULL) {
 			LOG_ERROR("Out of memory for flash bank buffer");
-			retval = ERROR_FAIL;
-			goto done;
+			return ERROR_FAIL;
 		}
 
 		if (padding_at_start)
-			memset(buffer, c->default_padded_value, padding_at_start);
+			memset(run->buffer, c->default_padded_value, padding_at_start);
+
+		run->bank = c;
+		run->address = run_address;
+		run->size = run_size;
+		run->filled = padding_at_start;
+		run->section = *section;
+		run->section_offset = *section_offset;
+
+		/* skip over the image data the run will consume, exactly as
+		 * flash_write_fill_run() reads it */
+		uint32_t idx = padding_at_start;
+		while (idx < run_size) {
+			uint32_t n = MIN(run_size - idx, sections[*section]->size - *section_offset);
+			idx += n;
+			*section_offset += n;
+			if (*section_offset >= sections[*section]->size) {
+				idx += padding[*section];
+				(*section)++;
+				*section_offset = 0;
+			}
+		}
+
+		return ERROR_OK;
+	}
 
-		buffer_idx = padding_at_start;
+	return ERROR_OK;
+}
 
-		/* read sections to the buffer */
-		while (buffer_idx < run_size) {
-			size_t size_read;
+/* Read up to max_bytes more image data and padding into a planned run. */
+static int flash_write_fill_run(struct flash_write_image *fwi,
+	struct flash_write_run *run, uint32_t max_bytes)
+{
+	struct image *image = fwi->image;
+	struct imagesection **sections = fwi->sections;
+	int *padding = fwi->padding;
+	uint32_t limit = run->filled + MIN(max_bytes, run->size - run->filled);
+
+	while (run->filled < limit) {
+		struct imagesection *s = sections[run->section];
+		size_t size_read;
+
+		size_read = limit - run->filled;
+		if (size_read > s->size - run->section_offset)
+			size_read = s->size - run->section_offset;
+
+		/* the sorted list points into image->sections */
+		int t_section_num = s - image->sections;
+
+		LOG_DEBUG("image_read_section: section = %d, t_section_num = %d, "
+				"section_offset = %"PRIu32", buffer_idx = %"PRIu32", size_read = %zu",
+			run->section, t_section_num, run->section_offset,
+			run->filled, size_read);
+		if (size_read > 0) {
+			int retval = image_read_section(image, t_section_num, run->section_offset,
+					size_read, run->buffer + run->filled, &size_read);
+			if (retval != ERROR_OK)
+				return retval;
+			if (size_read == 0)
+				return ERROR_FAIL;
+		}
 
-			size_read = run_size - buffer_idx;
-			if (size_read > sections[section]->size - section_offset)
-				size_read = sections[section]->size - section_offset;
+		run->filled += size_read;
+		run->section_offset += size_read;
 
-			/* KLUDGE!
-			 *
-			 * #¤%#"%¤% we have to figure out the section # from the sorted
-			 * list of pointers to sections to invoke image_read_section()...
-			 */
-			intptr_t diff = (intptr_t)sections[section] - (intptr_t)image->sections;
-			int t_section_num = diff / sizeof(struct imagesection);
-
-			LOG_DEBUG("image_read_section: section = %d, t_section_num = %d, "
-					"section_offset = %"PRIu32", buffer_idx = %"PRIu32", size_read = %zu",
-				section, t_section_num, section_offset,
-				buffer_idx, size_read);
-			retval = image_read_section(image, t_section_num, section_offset,
-					size_read, buffer + buffer_idx, &size_read);
-			if (retval != ERROR_OK || size_read == 0) {
-				free(buffer);
-				goto done;
+		/* pad after the section once it is complete */
+		if (run->section_offset >= s->size) {
+			if (padding[run->section]) {
+				memset(run->buffer + run->filled, run->bank->default_padded_value,
+						padding[run->section]);
+				run->filled += padding[run->section];
 			}
+			run->section++;
+			run->section_offset = 0;
+		}
+	}
 
-			buffer_idx += size_read;
-			section_offset += size_read;
+	return ERROR_OK;
+}
 
-			/* see if we need to pad the section */
-			if (padding[section]) {
-				memset(buffer + buffer_idx, c->default_padded_value, padding[section]);
-				buffer_idx += padding[section];
-			}
+/* Idle work for target_run_flash_async_algorithm(): prepare the next run
+ * a chunk at a time while the target drains its FIFO. */
+static bool flash_write_prefetch(void *priv)
+{
+	struct flash_write_image *fwi = priv;
+	struct flash_write_run *run = fwi->prefetch;
 
-			if (section_offset >= sections[section]->size) {
-				section++;
-				section_offset = 0;
-			}
-		}
+	if (run->filled >= run->size || fwi->prefetch_retval != ERROR_OK)
+		return false;
 
-		retval = ERROR_OK;
+	fwi->prefetch_retval = flash_write_fill_run(fwi, run, FLASH_WRITE_PREFETCH_CHUNK);
+	return true;
+}
 
-		if (unlock)
-			retval = flash_unlock_address_range(target, run_address, run_size);
-		if (retval == ERROR_OK) {
-			if (erase) {
-				/* calculate and erase sectors */
-				retval = flash_erase_address_range(target,
-						true, run_address, run_size);
-			}
-		}
+int flash_write_unlock(struct target *target, struct image *image,
+	uint32_t *written, int erase, bool unlock, bool incremental)
+{
+	int retval = ERROR_OK;
+	unsigned int sectors_checked = 0;
+	unsigned int sectors_skipped = 0;
 
-		if (retval == ERROR_OK) {
-			/* write flash sectors */
-			retval = flash_driver_write(c, buffer, run_address - c->base, run_size);
-		}
+	int section = 0;
+	uint32_t section_offset = 0;
+	struct flash_write_run runs[2];
+	struct flash_write_run *run = &runs[0];
+	struct flash_write_run *next = &runs[1];
+
+	if (written)
+		*written = 0;
+
+	if (erase) {
+		/* assume all sectors need erasing - stops any problems
+		 * when flash_write is called multiple times */
+
+		flash_set_dirty();
+	}
 
-		free(buffer);
+	memset(runs, 0, sizeof(runs));
+
+	struct flash_write_image fwi = {
+		.image = image,
+		.prefetch = next,
+		.prefetch_retval = ERROR_OK,
+	};
+
+	/* allocate padding array */
+	fwi.padding = calloc(image->num_sections, sizeof(*fwi.padding));
+
+	/* This fn requires all sections to be in ascending order of addresses,
+	 * whereas an image can have sections out of order. */
+	fwi.sections = malloc(sizeof(struct imagesection *) * image->num_sections);
+	if (image->num_sections > 0 && (fwi.padding == NULL || fwi.sections == NULL)) {
+		LOG_ERROR("Out of memory for image sections");
+		retval = ERROR_FAIL;
+		goto done;
+	}
+
+	int i;
+	for (i = 0; i < image->num_sections; i++)
+		fwi.sections[i] = &image->sections[i];
 
+	qsort(fwi.sections, image->num_sections, sizeof(struct imagesection *),
+		compare_section);
+
+	retval = flash_write_plan_run(target, &fwi, &section, &section_offset,
+			erase, unlock, run);
+	if (retval != ERROR_OK)
+		goto done;
+
+	/* loop until we reach end of the image */
+	while (run->size > 0) {
+		/* finish whatever wasn't prepared while the previous run was
+		 * being programmed */
+		retval = flash_write_fill_run(&fwi, run, UINT32_MAX);
+		if (retval != ERROR_OK)
+			goto done;
+
+		/* Plan the following run now, so it can be read from the image
+		 * while the target is busy with this one. Image types that are
+		 * read through the target can't be read in the background.
+		 */
+		retval = flash_write_plan_run(target, &fwi, &section, &section_offset,
+				erase, unlock, next);
+		if (retval != ERROR_OK)
+			goto done;
+
+		bool prefetch = next->size > 0 && image->type != IMAGE_MEMORY;
+		if (prefetch)
+			target_register_flash_async_idle_work(flash_write_prefetch, &fwi);
+
+		uint32_t programmed = run->size;
+
+		if (incremental && run->bank->num_sectors > 0)
+			retval = flash_write_run_incremental(target, run->bank, run->buffer,
+					run->address, run->size, erase, unlock,
+					&programmed, &sectors_checked, &sectors_skipped);
+		else
+			retval = flash_write_run(target, run->bank, run->buffer,
+					run->address, run->size, erase, unlock);
+
+		if (prefetch)
+			target_unregister_flash_async_idle_work(flash_write_prefetch, &fwi);
+
+		if (retval == ERROR_OK)
+			retval = fwi.prefetch_retval;
 		if (retval != ERROR_OK) {
 			/* abort operation */
 			goto done;
 		}
 
 		if (written != NULL)
-			*written += run_size;	/* add run size to total written counter */
+			*written += programmed;	/* add run size to total written counter */
+
+		free(run->buffer);
+		run->buffer = NULL;
+
+		struct flash_write_run *tmp = run;
+		run = next;
+		next = tmp;
+		fwi.prefetch = next;
 	}
 
+	if (incremental)
+		LOG_INFO("Skipped %u of %u flash sectors with unchanged contents",
+			sectors_skipped, sectors_checked);
+
 done:
-	free(sections);
-	free(padding);
+	free(runs[0].buffer);
+	free(runs[1].buffer);
+	free(fwi.sections);
+	free(fwi.padding);
 
 	return retval;
 }
@@ -957,7 +1259,7 @@ done:
 int flash_write(struct target *target, struct image *image,
 	uint32_t *written, int erase)
 {
-	return flash_write_unlock(target, image, written, erase, false);
+	return flash_write_unlock(target, image, written, erase, false, false);
 }
 
 struct flash_sector *alloc_block_array(uint32_t offset, uint32_t size, int num_blocks)
@@ -415,6 +415,7 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 	/* flash auto-erase is disabled by default*/
 	int auto_erase = 0;
 	bool auto_unlock = false;
+	bool incremental = false;
 
 	while (CMD_ARGC) {
 		if (strcmp(CMD_ARGV[0], "erase") == 0) {
@@ -427,6 +428,11 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 			CMD_ARGV++;
 			CMD_ARGC--;
 			command_print(CMD, "auto unlock enabled");
+		} else if (strcmp(CMD_ARGV[0], "incremental") == 0) {
+			incremental = true;
+			CMD_ARGV++;
+			CMD_ARGC--;
+			command_print(CMD, "incremental write enabled");
 		} else
 			break;
 	}
@@ -456,7 +462,8 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = flash_write_unlock(target, &image, &written, auto_erase, auto_unlock);
+	retval = flash_write_unlock(target, &image, &written, auto_erase, auto_unlock,
+			incremental);
 	if (retval != ERROR_OK) {
 		image_close(&image);
 		return retval;
@@ -473,6 +480,149 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 	return retval;
 }
 
+/* One target of "flash write_image_multi". */
+struct flash_multi_job {
+	struct target *target;
+	const char *filename;
+	struct image image;
+	bool image_open;
+	uint32_t written;
+	int retval;
+};
+
+COMMAND_HANDLER(handle_flash_write_image_multi_command)
+{
+	struct flash_multi_job *jobs;
+	unsigned int num_jobs = 0;
+	int erase = 0;
+	bool unlock = false;
+	bool incremental = false;
+	int retval = ERROR_OK;
+	unsigned int i;
+
+	while (CMD_ARGC) {
+		if (strcmp(CMD_ARGV[0], "erase") == 0) {
+			erase = 1;
+			command_print(CMD, "auto erase enabled");
+		} else if (strcmp(CMD_ARGV[0], "unlock") == 0) {
+			unlock = true;
+			command_print(CMD, "auto unlock enabled");
+		} else if (strcmp(CMD_ARGV[0], "incremental") == 0) {
+			incremental = true;
+			command_print(CMD, "incremental write enabled");
+		} else
+			break;
+		CMD_ARGV++;
+		CMD_ARGC--;
+	}
+
+	if (CMD_ARGC < 3 || strcmp(CMD_ARGV[0], "-target") != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	for (i = 0; i < CMD_ARGC; i++) {
+		if (strcmp(CMD_ARGV[i], "-target") == 0)
+			num_jobs++;
+	}
+
+	jobs = calloc(num_jobs, sizeof(*jobs));
+	if (jobs == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	/* -target name filename [offset [file_type]] */
+	unsigned int argi = 0;
+	for (i = 0; i < num_jobs; i++) {
+		struct flash_multi_job *job = &jobs[i];
+		unsigned int argc = 1;
+
+		while (argi + argc < CMD_ARGC && strcmp(CMD_ARGV[argi + argc], "-target") != 0)
+			argc++;
+		if (argc < 3 || argc > 5) {
+			retval = ERROR_COMMAND_SYNTAX_ERROR;
+			goto done;
+		}
+
+		const char **argv = CMD_ARGV + argi;
+		argi += argc;
+
+		job->target = get_target(argv[1]);
+		if (!job->target) {
+			command_print(CMD, "Target '%s' not defined", argv[1]);
+			retval = ERROR_FAIL;
+			goto done;
+		}
+		for (unsigned int j = 0; j < i; j++) {
+			if (jobs[j].target == job->target) {
+				command_print(CMD, "Target '%s' given more than once", argv[1]);
+				retval = ERROR_COMMAND_ARGUMENT_INVALID;
+				goto done;
+			}
+		}
+		job->filename = argv[2];
+
+		if (argc >= 4) {
+			job->image.base_address_set = 1;
+			retval = parse_llong(argv[3], &job->image.base_address);
+			if (retval != ERROR_OK) {
+				command_print(CMD, "Invalid offset '%s'", argv[3]);
+				goto done;
+			}
+		} else {
+			job->image.base_address_set = 0;
+			job->image.base_address = 0x0;
+		}
+
+		job->image.start_address_set = 0;
+
+		retval = image_open(&job->image, job->filename, (argc == 5) ? argv[4] : NULL);
+		if (retval != ERROR_OK)
+			goto done;
+		job->image_open = true;
+	}
+
+	struct duration bench;
+	duration_start(&bench);
+
+	/* one target after the other; a failure doesn't stop the others */
+	for (i = 0; i < num_jobs; i++) {
+		struct flash_multi_job *job = &jobs[i];
+		LOG_DEBUG("writing %s to %s", job->filename, target_name(job->target));
+		job->retval = flash_write_unlock(job->target, &job->image, &job->written,
+				erase, unlock, incremental);
+	}
+
+	uint32_t written = 0;
+	for (i = 0; i < num_jobs; i++) {
+		struct flash_multi_job *job = &jobs[i];
+		if (job->retval != ERROR_OK) {
+			command_print(CMD, "failed to write %s to %s", job->filename,
+				target_name(job->target));
+			if (retval == ERROR_OK)
+				retval = job->retval;
+			continue;
+		}
+		command_print(CMD, "wrote %" PRIu32 " bytes from file %s to %s",
+			job->written, job->filename, target_name(job->target));
+		written += job->written;
+	}
+
+	if ((ERROR_OK == retval) && (duration_measure(&bench) == ERROR_OK)) {
+		command_print(CMD, "wrote %" PRIu32 " bytes to %u targets "
+			"in %fs (%0.3f KiB/s)", written, num_jobs,
+			duration_elapsed(&bench), duration_kbps(&bench, written));
+	}
+
+done:
+	for (i = 0; i < num_jobs; i++) {
+		if (jobs[i].image_open)
+			image_close(&jobs[i].image);
+	}
+	free(jobs);
+
+	return retval;
+}
+
 COMMAND_HANDLER(handle_flash_fill_command)
 {
 	target_addr_t address;
@@ -1061,11 +1211,23 @@ static const struct command_registration flash_exec_command_handlers[] = {
 		.name = "write_image",
 		.handler = handle_flash_write_image_command,
 		.mode = COMMAND_EXEC,
-		.usage = "[erase] [unlock] filename [offset [file_type]]",
+		.usage = "[erase] [unlock] [incremental] filename [offset [file_type]]",
 		.help = "Write an image to flash.  Optionally first unprotect "
-			"and/or erase the region to be used.  Allow optional "
+			"and/or erase the region to be used.  Optionally skip "
+			"sectors already holding the image data.  Allow optional "
 			"offset from beginning of bank (defaults to zero)",
 	},
+	{
+		.name = "write_image_multi",
+		.handler = handle_flash_write_image_multi_command,
+		.mode = COMMAND_EXEC,
+		.usage = "[erase] [unlock] [incremental] "
+			"('-target' target_name filename [offset [file_type]])...",
+		.help = "Write one image each to the flash of several targets, "
+			"one target after the other, and report the result of "
+			"every target.  Each target may be given only once.  "
+			"Options are as for write_image.",
+	},
 	{
 		.name = "read_bank",
 		.handler = handle_flash_read_bank_command,
@@ -18,6 +18,7 @@ proc program_error {description exit} {
 proc program {filename args} {
 	set exit 0
 	set needsflash 1
+	set write_args "erase"
 
 	foreach arg $args {
 		if {[string equal $arg "preverify"]} {
@@ -28,6 +29,8 @@ proc program {filename args} {
 			set reset 1
 		} elseif {[string equal $arg "exit"]} {
 			set exit 1
+		} elseif {[string equal $arg "incremental"]} {
+			set write_args "erase incremental"
 		} else {
 			set address $arg
 		}
@@ -65,7 +68,7 @@ proc program {filename args} {
 	if {$needsflash == 1} {
 		echo "** Programming Started **"
 
-		if {[catch {eval flash write_image erase $flash_args}] == 0} {
+		if {[catch {eval flash write_image $write_args $flash_args}] == 0} {
 			echo "** Programming Finished **"
 			if {[info exists verify]} {
 				# verify phase
@@ -98,8 +101,8 @@ proc program {filename args} {
 	return
 }
 
-add_help_text program "write an image to flash, address is only required for binary images. verify, reset, exit are optional"
-add_usage_text program "<filename> \[address\] \[pre-verify\] \[verify\] \[reset\] \[exit\]"
+add_help_text program "write an image to flash, address is only required for binary images. incremental, verify, reset, exit are optional"
+add_usage_text program "<filename> \[address\] \[pre-verify\] \[incremental\] \[verify\] \[reset\] \[exit\]"
 
 # stm32[f0x|f3x] uses the same flash driver as the stm32f1x
 proc stm32f0x args { eval stm32f1x $args }
@@ -0,0 +1,78 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+/* Times hexify() and unhexify() on a memory dump sized buffer.  Built by
+ * "make check" but not run by it, since timings depend on the host:
+ *
+ *   ./src/helper/binarybuffer_bench [KiB [rounds]]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "binarybuffer.h"
+#include "log.h"
+#include "time_support.h"
+
+static void report(const char *name, struct duration *bench, size_t bytes)
+{
+	if (duration_measure(bench) != ERROR_OK) {
+		printf("%s: no time measured\n", name);
+		return;
+	}
+
+	printf("%-9s %zu KiB in %fs (%0.3f KiB/s)\n", name, bytes / 1024,
+		duration_elapsed(bench), duration_kbps(bench, bytes));
+}
+
+int main(int argc, char **argv)
+{
+	size_t size = (argc > 1 ? strtoul(argv[1], NULL, 0) : 4096) * 1024;
+	unsigned rounds = argc > 2 ? strtoul(argv[2], NULL, 0) : 16;
+	struct duration bench;
+
+	uint8_t *bin = malloc(size);
+	char *hex = malloc(2 * size + 1);
+	if (!bin || !hex) {
+		printf("out of memory\n");
+		return 1;
+	}
+
+	for (size_t i = 0; i < size; i++)
+		bin[i] = i * 0x3b + (i >> 8);
+
+	duration_start(&bench);
+	for (unsigned r = 0; r < rounds; r++)
+		hexify(hex, bin, size, 2 * size + 1);
+	report("hexify", &bench, size * rounds);
+
+	duration_start(&bench);
+	for (unsigned r = 0; r < rounds; r++) {
+		if (unhexify(bin, hex, size) != size) {
+			printf("unhexify stopped early\n");
+			return 1;
+		}
+	}
+	report("unhexify", &bench, size * rounds);
+
+	free(hex);
+	free(bin);
+
+	return 0;
+}
@@ -0,0 +1,281 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+/* Checks of the binarybuffer helpers, run by "make check". */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "binarybuffer.h"
+
+#define BUF_SIZE 16
+
+static int failures;
+
+static void check_bytes(const char *name, const uint8_t *got,
+	const uint8_t *expected, unsigned size)
+{
+	if (memcmp(got, expected, size) == 0)
+		return;
+
+	printf("FAIL %s:", name);
+	for (unsigned i = 0; i < size; i++)
+		printf(" %02x/%02x", got[i], expected[i]);
+	printf(" (got/expected)\n");
+	failures++;
+}
+
+static void check_size(const char *name, size_t got, size_t expected)
+{
+	if (got == expected)
+		return;
+
+	printf("FAIL %s: returned %zu, expected %zu\n", name, got, expected);
+	failures++;
+}
+
+/* one bit at a time, the way buf_set_buf() has to behave */
+static void ref_set_buf(const uint8_t *src, unsigned src_start,
+	uint8_t *dst, unsigned dst_start, unsigned len)
+{
+	for (unsigned i = 0; i < len; i++) {
+		unsigned s = src_start + i, d = dst_start + i;
+
+		if ((src[s / 8] >> (s % 8)) & 1)
+			dst[d / 8] |= 1 << (d % 8);
+		else
+			dst[d / 8] &= ~(1 << (d % 8));
+	}
+}
+
+/* the nibble at a time unhexify() the table driven one has to match */
+static size_t ref_unhexify(uint8_t *bin, const char *hex, size_t count)
+{
+	size_t i;
+	char tmp;
+
+	memset(bin, 0, count);
+
+	for (i = 0; i < 2 * count; i++) {
+		if (hex[i] >= 'a' && hex[i] <= 'f')
+			tmp = hex[i] - 'a' + 10;
+		else if (hex[i] >= 'A' && hex[i] <= 'F')
+			tmp = hex[i] - 'A' + 10;
+		else if (hex[i] >= '0' && hex[i] <= '9')
+			tmp = hex[i] - '0';
+		else
+			return i / 2;
+
+		bin[i / 2] |= tmp << (4 * ((i + 1) % 2));
+	}
+
+	return i / 2;
+}
+
+/* the same for hexify() */
+static size_t ref_hexify(char *hex, const uint8_t *bin, size_t count, size_t length)
+{
+	static const char digits[] = "0123456789abcdef";
+	size_t i;
+
+	if (!length)
+		return 0;
+
+	for (i = 0; i < length - 1 && i < 2 * count; i++)
+		hex[i] = digits[(bin[i / 2] >> (4 * ((i + 1) % 2))) & 0x0f];
+
+	hex[i] = 0;
+
+	return i;
+}
+
+static void check_unhexify(const char *name, const char *hex, size_t count)
+{
+	uint8_t got[BUF_SIZE], expected[BUF_SIZE];
+
+	memset(got, 0xa5, sizeof(got));
+	memset(expected, 0xa5, sizeof(expected));
+	check_size(name, unhexify(got, hex, count), ref_unhexify(expected, hex, count));
+	check_bytes(name, got, expected, sizeof(got));
+}
+
+static void test_unhexify(void)
+{
+	static const char *const valid[] = {
+		"0123456789abcdef",
+		"0123456789ABCDEF",
+		"fEdCbA9876543210",
+	};
+	/* an invalid digit in every position of a pair, including the
+	 * characters next to the digit ranges */
+	static const char invalid[] = "/:@G`gx \n";
+	char hex[2 * BUF_SIZE + 1];
+	char name[64];
+
+	for (unsigned v = 0; v < ARRAY_SIZE(valid); v++) {
+		for (size_t count = 0; count <= 8; count++) {
+			snprintf(name, sizeof(name), "unhexify \"%s\" count %zu", valid[v], count);
+			check_unhexify(name, valid[v], count);
+		}
+	}
+
+	for (unsigned c = 0; c < sizeof(invalid) - 1; c++) {
+		for (size_t pos = 0; pos < 8; pos++) {
+			strcpy(hex, "a1B2c3D4");
+			hex[pos] = invalid[c];
+			snprintf(name, sizeof(name), "unhexify invalid 0x%02x at %zu",
+				invalid[c], pos);
+			check_unhexify(name, hex, 4);
+		}
+	}
+
+	/* a string ending in the middle of a pair */
+	check_unhexify("unhexify odd string", "a1B", 2);
+
+	/* known values, both cases */
+	uint8_t bin[4];
+	check_size("unhexify upper", unhexify(bin, "DEADBEEF", 4), 4);
+	check_bytes("unhexify upper", bin, (const uint8_t []){ 0xde, 0xad, 0xbe, 0xef }, 4);
+	check_size("unhexify lower", unhexify(bin, "0a1b2c3d", 4), 4);
+	check_bytes("unhexify lower", bin, (const uint8_t []){ 0x0a, 0x1b, 0x2c, 0x3d }, 4);
+}
+
+static void test_hexify(void)
+{
+	uint8_t bin[BUF_SIZE];
+	char got[2 * BUF_SIZE + 2], expected[2 * BUF_SIZE + 2];
+	char name[64];
+
+	for (unsigned i = 0; i < BUF_SIZE; i++)
+		bin[i] = i * 0x3b + 0x91;
+
+	/* every count against every output length, odd ones included */
+	for (size_t count = 0; count <= 8; count++) {
+		for (size_t length = 0; length <= 2 * 8 + 2; length++) {
+			memset(got, 0x5a, sizeof(got));
+			memset(expected, 0x5a, sizeof(expected));
+			snprintf(name, sizeof(name), "hexify count %zu length %zu", count, length);
+			check_size(name, hexify(got, bin, count, length),
+				ref_hexify(expected, bin, count, length));
+			check_bytes(name, (const uint8_t *)got, (const uint8_t *)expected,
+				sizeof(got));
+		}
+	}
+
+	check_size("hexify value", hexify(got, (const uint8_t []){ 0xde, 0xad, 0x0f }, 3, 7), 6);
+	if (strcmp(got, "dead0f") != 0) {
+		printf("FAIL hexify value: \"%s\"\n", got);
+		failures++;
+	}
+}
+
+static void test_hex_round_trip(void)
+{
+	uint8_t bin[256], back[256];
+	char hex[2 * 256 + 1];
+
+	for (unsigned i = 0; i < 256; i++)
+		bin[i] = i;
+
+	check_size("round trip hexify", hexify(hex, bin, 256, sizeof(hex)), 512);
+	check_size("round trip unhexify", unhexify(back, hex, 256), 256);
+	check_bytes("round trip", back, bin, sizeof(bin));
+
+	/* and through upper case digits */
+	for (unsigned i = 0; i < 512; i++) {
+		if (hex[i] >= 'a')
+			hex[i] -= 'a' - 'A';
+	}
+	check_size("round trip upper", unhexify(back, hex, 256), 256);
+	check_bytes("round trip upper", back, bin, sizeof(bin));
+}
+
+/* a set_buf of one case onto a known destination */
+static void check_case(const char *name, const uint8_t *src, unsigned dst_fill,
+	unsigned dst_start, unsigned len, const uint8_t *expected, unsigned size)
+{
+	uint8_t dst[BUF_SIZE];
+
+	memset(dst, dst_fill, sizeof(dst));
+	buf_set_buf(src, 0, dst, dst_start, len);
+	check_bytes(name, dst, expected, size);
+}
+
+static void test_set_buf_cases(void)
+{
+	/* odd dst_start: a full byte split over two destination bytes */
+	check_case("odd dst_start", (const uint8_t []){ 0xff }, 0x00,
+		3, 8, (const uint8_t []){ 0xf8, 0x07, 0x00 }, 3);
+
+	/* length not a multiple of 8: only the low bits of the last byte */
+	check_case("len % 8", (const uint8_t []){ 0xff, 0xff }, 0x00,
+		0, 11, (const uint8_t []){ 0xff, 0x07, 0x00 }, 3);
+
+	/* final partial byte crossing into dst[1], keeping the bits around it */
+	check_case("partial into dst[1], set", (const uint8_t []){ 0x1f }, 0x00,
+		6, 5, (const uint8_t []){ 0xc0, 0x07, 0x00 }, 3);
+	check_case("partial into dst[1], clear", (const uint8_t []){ 0x00 }, 0xff,
+		6, 5, (const uint8_t []){ 0x3f, 0xf8, 0xff }, 3);
+
+	/* several bytes, odd start and length, ending in the next byte */
+	check_case("odd start and len", (const uint8_t []){ 0x5a, 0xa5, 0x03 }, 0x00,
+		5, 18, (const uint8_t []){ 0x40, 0xab, 0x74, 0x00 }, 4);
+}
+
+/* every offset and length against the bitwise reference */
+static void test_set_buf_sweep(void)
+{
+	uint8_t src[BUF_SIZE], got[BUF_SIZE], expected[BUF_SIZE];
+	char name[64];
+
+	for (unsigned i = 0; i < BUF_SIZE; i++)
+		src[i] = i * 0x3b + 0x91;
+
+	for (unsigned src_start = 0; src_start < 24; src_start++) {
+		for (unsigned dst_start = 0; dst_start < 24; dst_start++) {
+			for (unsigned len = 0; len <= 8 * BUF_SIZE - 24; len++) {
+				for (unsigned fill = 0; fill <= 0xff; fill += 0xff) {
+					memset(got, fill, sizeof(got));
+					memset(expected, fill, sizeof(expected));
+					buf_set_buf(src, src_start, got, dst_start, len);
+					ref_set_buf(src, src_start, expected, dst_start, len);
+					snprintf(name, sizeof(name), "src_start %u dst_start %u len %u fill %02x",
+						src_start, dst_start, len, fill);
+					check_bytes(name, got, expected, sizeof(got));
+				}
+			}
+		}
+	}
+}
+
+int main(void)
+{
+	test_set_buf_cases();
+	test_set_buf_sweep();
+	test_unhexify();
+	test_hexify();
+	test_hex_round_trip();
+
+	if (failures) {
+		printf("%d binarybuffer checks failed\n", failures);
+		return 1;
+	}
+
+	return 0;
+}
@@ -37,6 +37,7 @@
 struct cmd_queue_page {
 	struct cmd_queue_page *next;
 	void *address;
+	size_t size;
 	size_t used;
 };
 
@@ -44,6 +45,10 @@ struct cmd_queue_page {
 static struct cmd_queue_page *cmd_queue_pages;
 static struct cmd_queue_page *cmd_queue_pages_tail;
 
+/* Allocation volume of the current queue, reported when it is released */
+static size_t cmd_queue_alloc_bytes;
+static size_t cmd_queue_scan_bytes;
+
 struct jtag_command *jtag_command_queue;
 static struct jtag_command **next_command_pointer = &jtag_command_queue;
 
@@ -114,40 +119,59 @@ void *cmd_queue_alloc(size_t size)
 
 	if (*p_page) {
 		p_page = &cmd_queue_pages_tail;
-		if (CMD_QUEUE_PAGE_SIZE - (*p_page)->used < size)
+		if ((*p_page)->size - (*p_page)->used < size)
 			p_page = &((*p_page)->next);
 	}
 
 	if (!*p_page) {
 		*p_page = malloc(sizeof(struct cmd_queue_page));
 		(*p_page)->used = 0;
-		size_t alloc_size = (size < CMD_QUEUE_PAGE_SIZE) ?
+		(*p_page)->size = (size < CMD_QUEUE_PAGE_SIZE) ?
 					CMD_QUEUE_PAGE_SIZE : size;
-		(*p_page)->address = malloc(alloc_size);
+		(*p_page)->address = malloc((*p_page)->size);
 		(*p_page)->next = NULL;
-		cmd_queue_pages_tail = *p_page;
 	}
+	cmd_queue_pages_tail = *p_page;
 
 	offset = (*p_page)->used;
 	(*p_page)->used += size;
+	cmd_queue_alloc_bytes += size;
 
 	t = (*p_page)->address;
 	return t + offset;
 }
 
+/*
+ * Release the queue memory.  The first page is kept and recycled for the
+ * next queue, so the common case of a queue that fits in one page costs
+ * no malloc()/free() at all.
+ */
 static void cmd_queue_free(void)
 {
 	struct cmd_queue_page *page = cmd_queue_pages;
 
+	if (cmd_queue_alloc_bytes)
+		LOG_DEBUG_IO("JTAG queue released %zu bytes, %zu of them scan buffers",
+				cmd_queue_alloc_bytes, cmd_queue_scan_bytes);
+	cmd_queue_alloc_bytes = 0;
+	cmd_queue_scan_bytes = 0;
+
+	if (page && page->size == CMD_QUEUE_PAGE_SIZE) {
+		page->used = 0;
+		cmd_queue_pages_tail = page;
+		page = page->next;
+		cmd_queue_pages->next = NULL;
+	} else {
+		cmd_queue_pages = NULL;
+		cmd_queue_pages_tail = NULL;
+	}
+
 	while (page) {
 		struct cmd_queue_page *last = page;
 		free(page->address);
 		page = page->next;
 		free(last);
 	}
-
-	cmd_queue_pages = NULL;
-	cmd_queue_pages_tail = NULL;
 }
 
 void jtag_command_queue_reset(void)
@@ -158,6 +182,162 @@ void jtag_command_queue_reset(void)
 	next_command_pointer = &jtag_command_queue;
 }
 
+/**
+ * A scan can be folded into the preceding one when that one leaves the
+ * TAP in the same shift register's Shift or Pause state.  From Pause
+ * the next scan returns to Shift via Exit2 without passing Capture or
+ * Update, so concatenating the fields clocks exactly the same TMS/TDI
+ * sequence minus the detour.
+ */
+static bool jtag_scan_continues(const struct scan_command *prev,
+		const struct scan_command *next)
+{
+	if (prev->ir_scan != next->ir_scan)
+		return false;
+
+	if (prev->ir_scan)
+		return prev->end_state == TAP_IRSHIFT || prev->end_state == TAP_IRPAUSE;
+	return prev->end_state == TAP_DRSHIFT || prev->end_state == TAP_DRPAUSE;
+}
+
+/*
+ * Upper bounds for a merged scan.  Drivers size their buffers for the
+ * scans the target code queues, not for whole chains of them (xds110
+ * gives up past 4 KiB of scan data or 1024 fields), so stay well below
+ * the smallest known limit.  A scan already larger on its own is left
+ * alone; it just does not absorb its neighbours.
+ */
+#define JTAG_COALESCE_MAX_SCAN_BITS		(512 * 8)
+#define JTAG_COALESCE_MAX_SCAN_FIELDS	64
+
+/* Fold the run of scans following cmd that continue it into cmd. */
+static void jtag_coalesce_scans(struct jtag_command *cmd)
+{
+	struct jtag_command *last = cmd;
+	int num_fields = cmd->cmd.scan->num_fields;
+	int num_bits = jtag_scan_size(cmd->cmd.scan);
+
+	while (last->next && last->next->type == JTAG_SCAN &&
+			jtag_scan_continues(last->cmd.scan, last->next->cmd.scan)) {
+		const struct scan_command *next = last->next->cmd.scan;
+		int next_bits = jtag_scan_size(next);
+
+		if (num_fields + next->num_fields > JTAG_COALESCE_MAX_SCAN_FIELDS ||
+				num_bits + next_bits > JTAG_COALESCE_MAX_SCAN_BITS)
+			break;
+
+		last = last->next;
+		num_fields += next->num_fields;
+		num_bits += next_bits;
+	}
+
+	if (last == cmd)
+		return;
+
+	struct scan_field *fields = cmd_queue_alloc(num_fields * sizeof(struct scan_field));
+	struct scan_field *field = fields;
+	for (struct jtag_command *c = cmd; c != last->next; c = c->next) {
+		memcpy(field, c->cmd.scan->fields, c->cmd.scan->num_fields * sizeof(struct scan_field));
+		field += c->cmd.scan->num_fields;
+	}
+
+	cmd->cmd.scan->fields = fields;
+	cmd->cmd.scan->num_fields = num_fields;
+	cmd->cmd.scan->end_state = last->cmd.scan->end_state;
+	cmd->next = last->next;
+}
+
+static void jtag_coalesce_pathmoves(struct jtag_command *cmd)
+{
+	struct jtag_command *last = cmd;
+	int num_states = cmd->cmd.pathmove->num_states;
+
+	while (last->next && last->next->type == JTAG_PATHMOVE) {
+		last = last->next;
+		num_states += last->cmd.pathmove->num_states;
+	}
+
+	if (last == cmd)
+		return;
+
+	tap_state_t *path = cmd_queue_alloc(num_states * sizeof(tap_state_t));
+	tap_state_t *state = path;
+	for (struct jtag_command *c = cmd; c != last->next; c = c->next) {
+		memcpy(state, c->cmd.pathmove->path, c->cmd.pathmove->num_states * sizeof(tap_state_t));
+		state += c->cmd.pathmove->num_states;
+	}
+
+	cmd->cmd.pathmove->path = path;
+	cmd->cmd.pathmove->num_states = num_states;
+	cmd->next = last->next;
+}
+
+/**
+ * Merge adjacent commands that drivers would otherwise execute one by
+ * one, without changing the sequence of TAP states visited:
+ *
+ * - scans continuing from the Shift or Pause state of the same register,
+ *   up to JTAG_COALESCE_MAX_SCAN_BITS and JTAG_COALESCE_MAX_SCAN_FIELDS,
+ * - consecutive pathmoves,
+ * - runtests following a runtest that ends in Run-Test/Idle,
+ * - consecutive stableclocks,
+ * - repeated TLR resets.
+ *
+ * Everything is reallocated from the command queue pages, so the queue
+ * still releases in one piece.
+ */
+void jtag_command_queue_coalesce(void)
+{
+	unsigned before = 0, after = 0;
+
+	for (struct jtag_command *cmd = jtag_command_queue; cmd; cmd = cmd->next)
+		before++;
+
+	struct jtag_command *cmd = jtag_command_queue;
+	while (cmd) {
+		struct jtag_command *next = cmd->next;
+
+		switch (cmd->type) {
+		case JTAG_SCAN:
+			jtag_coalesce_scans(cmd);
+			break;
+		case JTAG_PATHMOVE:
+			jtag_coalesce_pathmoves(cmd);
+			break;
+		case JTAG_RUNTEST:
+			while (next && next->type == JTAG_RUNTEST &&
+					cmd->cmd.runtest->end_state == TAP_IDLE &&
+					next->cmd.runtest->num_cycles <= INT_MAX - cmd->cmd.runtest->num_cycles) {
+				cmd->cmd.runtest->num_cycles += next->cmd.runtest->num_cycles;
+				cmd->cmd.runtest->end_state = next->cmd.runtest->end_state;
+				next = cmd->next = next->next;
+			}
+			break;
+		case JTAG_STABLECLOCKS:
+			while (next && next->type == JTAG_STABLECLOCKS &&
+					next->cmd.stableclocks->num_cycles <= INT_MAX - cmd->cmd.stableclocks->num_cycles) {
+				cmd->cmd.stableclocks->num_cycles += next->cmd.stableclocks->num_cycles;
+				next = cmd->next = next->next;
+			}
+			break;
+		case JTAG_TLR_RESET:
+			while (next && next->type == JTAG_TLR_RESET)
+				next = cmd->next = next->next;
+			break;
+		default:
+			break;
+		}
+
+		after++;
+		if (!cmd->next)
+			next_command_pointer = &cmd->next;
+		cmd = cmd->next;
+	}
+
+	if (after != before)
+		LOG_DEBUG_IO("JTAG queue coalesced from %u to %u commands", before, after);
+}
+
 /**
  * Copy a struct scan_field for insertion into the queue.
  *
@@ -203,7 +383,9 @@ int jtag_build_buffer(const struct scan_command *cmd, uint8_t **buffer)
 	int i;
 
 	bit_count = jtag_scan_size(cmd);
-	*buffer = calloc(1, DIV_ROUND_UP(bit_count, 8));
+	*buffer = cmd_queue_alloc(DIV_ROUND_UP(bit_count, 8));
+	memset(*buffer, 0, DIV_ROUND_UP(bit_count, 8));
+	cmd_queue_scan_bytes += DIV_ROUND_UP(bit_count, 8);
 
 	bit_count = 0;
 
@@ -254,7 +436,11 @@ int jtag_read_buffer(uint8_t *buffer, const struct scan_command *cmd)
 		if (cmd->fields[i].in_value) {
 			int num_bits = cmd->fields[i].num_bits;
 			uint8_t *captured = buf_set_buf(buffer, bit_count,
-					malloc(DIV_ROUND_UP(num_bits, 8)), 0, num_bits);
+					cmd->fields[i].in_value, 0, num_bits);
+
+			/* same result as buf_cpy(): clear the unused top bits */
+			if (num_bits % 8)
+				captured[num_bits / 8] &= (1 << (num_bits % 8)) - 1;
 
 			if (LOG_LEVEL_IS(LOG_LVL_DEBUG_IO)) {
 				char *char_buf = buf_to_str(captured,
@@ -266,11 +452,6 @@ int jtag_read_buffer(uint8_t *buffer, const struct scan_command *cmd)
 						i, num_bits, char_buf);
 				free(char_buf);
 			}
-
-			if (cmd->fields[i].in_value)
-				buf_cpy(captured, cmd->fields[i].in_value, num_bits);
-
-			free(captured);
 		}
 		bit_count += cmd->fields[i].num_bits;
 	}
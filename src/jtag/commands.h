@@ -167,11 +167,18 @@ void *cmd_queue_alloc(size_t size);
 
 void jtag_queue_command(struct jtag_command *cmd);
 void jtag_command_queue_reset(void);
+void jtag_command_queue_coalesce(void);
 
 void jtag_scan_field_clone(struct scan_field *dst, const struct scan_field *src);
 enum scan_type jtag_scan_type(const struct scan_command *cmd);
 int jtag_scan_size(const struct scan_command *cmd);
 int jtag_read_buffer(uint8_t *buffer, const struct scan_command *cmd);
+/**
+ * Pack the out_value bits of all fields of @a cmd into one buffer.
+ * The buffer comes from cmd_queue_alloc() and lives until the queue is
+ * reset after execution; callers must not free it.
+ * @returns the number of bits in the scan.
+ */
 int jtag_build_buffer(const struct scan_command *cmd, uint8_t **buffer);
 
 #endif /* OPENOCD_JTAG_COMMANDS_H */
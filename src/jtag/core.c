@@ -50,6 +50,9 @@ static int jtag_flush_queue_count;
 /* Sleep this # of ms after flushing the queue */
 static int jtag_flush_queue_sleep;
 
+/* Merge adjacent queued commands before handing them to the driver */
+static bool jtag_queue_coalesce = true;
+
 static void jtag_add_scan_check(struct jtag_tap *active,
 		void (*jtag_add_scan)(struct jtag_tap *active,
 		int in_num_fields,
@@ -136,6 +139,16 @@ void jtag_set_flush_queue_sleep(int ms)
 	jtag_flush_queue_sleep = ms;
 }
 
+void jtag_set_queue_coalesce(bool enable)
+{
+	jtag_queue_coalesce = enable;
+}
+
+bool jtag_get_queue_coalesce(void)
+{
+	return jtag_queue_coalesce;
+}
+
 void jtag_set_error(int error)
 {
 	if ((error == ERROR_OK) || (jtag_error != ERROR_OK))
@@ -951,6 +964,11 @@ int default_interface_jtag_execute_queue(void)
 			return ERROR_OK;
 	}
 
+#if !BUILD_ZY1000
+	if (jtag_queue_coalesce)
+		jtag_command_queue_coalesce();
+#endif
+
 	int result = jtag->jtag_ops->execute_queue();
 
 #if !BUILD_ZY1000
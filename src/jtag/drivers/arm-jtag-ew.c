@@ -663,9 +663,6 @@ static int armjtagew_tap_execute(void)
 					armjtagew_tap_init();
 					return ERROR_JTAG_QUEUE_FAILED;
 				}
-
-				if (pending_scan_result->buffer != NULL)
-					free(pending_scan_result->buffer);
 			}
 		} else {
 			LOG_ERROR("armjtagew_tap_execute, wrong result %d, expected %d",
@@ -358,8 +358,6 @@ int bitbang_execute_queue(void)
 					return ERROR_FAIL;
 				if (jtag_read_buffer(buffer, cmd->cmd.scan) != ERROR_OK)
 					retval = ERROR_JTAG_QUEUE_FAILED;
-				if (buffer)
-					free(buffer);
 				break;
 			case JTAG_SLEEP:
 				LOG_DEBUG_IO("sleep %" PRIi32, cmd->cmd.sleep->us);
@@ -564,6 +562,24 @@ static void bitbang_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay
 	}
 }
 
+static void bitbang_swd_read_reg_block(uint8_t cmd, uint32_t *values, unsigned int count,
+		uint32_t ap_delay_clk)
+{
+	LOG_DEBUG("bitbang_swd_read_reg_block %u", count);
+
+	for (unsigned int i = 0; i < count && queued_retval == ERROR_OK; i++)
+		bitbang_swd_read_reg(cmd, &values[i], ap_delay_clk);
+}
+
+static void bitbang_swd_write_reg_block(uint8_t cmd, const uint32_t *values, unsigned int count,
+		uint32_t ap_delay_clk)
+{
+	LOG_DEBUG("bitbang_swd_write_reg_block %u", count);
+
+	for (unsigned int i = 0; i < count && queued_retval == ERROR_OK; i++)
+		bitbang_swd_write_reg(cmd, values[i], ap_delay_clk);
+}
+
 static int bitbang_swd_run_queue(void)
 {
 	LOG_DEBUG("bitbang_swd_run_queue");
@@ -582,5 +598,7 @@ const struct swd_driver bitbang_swd = {
 	.switch_seq = bitbang_swd_switch_seq,
 	.read_reg = bitbang_swd_read_reg,
 	.write_reg = bitbang_swd_write_reg,
+	.read_reg_block = bitbang_swd_read_reg_block,
+	.write_reg_block = bitbang_swd_write_reg_block,
 	.run = bitbang_swd_run_queue,
 };
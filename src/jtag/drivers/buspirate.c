@@ -775,8 +775,6 @@ static int buspirate_tap_execute(void)
 			buspirate_tap_init();
 			return ERROR_JTAG_QUEUE_FAILED;
 		}
-
-		free(buffer);
 	}
 	buspirate_tap_init();
 	return ERROR_OK;
@@ -39,6 +39,9 @@
 #include <jtag/tcl.h>
 
 #include <hidapi.h>
+#ifdef HAVE_LIBUSB1
+#include <libusb.h>
+#endif
 
 /*
  * See CMSIS-DAP documentation:
@@ -163,8 +166,18 @@ static const char * const info_caps_str[] = {
 /* max clock speed (kHz) */
 #define DAP_MAX_CLOCK             5000
 
+struct cmsis_dap_backend;
+
 struct cmsis_dap {
+	const struct cmsis_dap_backend *backend;
 	hid_device *dev_handle;
+#ifdef HAVE_LIBUSB1
+	libusb_context *usb_ctx;
+	libusb_device_handle *usb_handle;
+	int usb_interface;
+	uint8_t ep_out;
+	uint8_t ep_in;
+#endif
 	uint16_t packet_size;
 	int packet_count;
 	uint8_t *packet_buffer;
@@ -172,6 +185,23 @@ struct cmsis_dap {
 	uint8_t mode;
 };
 
+/*
+ * CMSIS-DAP v1 probes are HID devices, limited to one report per frame.
+ * v2 probes add a vendor specific interface with a pair of bulk
+ * endpoints.  Both carry the same command packets; packet_buffer[0] is
+ * the HID report number and is not sent over bulk.
+ */
+struct cmsis_dap_backend {
+	const char *name;
+	int (*open)(struct cmsis_dap *dap);
+	void (*close)(struct cmsis_dap *dap);
+	/** Read one reply into packet_buffer. Returns the number of bytes
+	 * received, 0 on timeout or -1 on error. */
+	int (*read)(struct cmsis_dap *dap, int timeout_ms);
+	/** Send the first txlen bytes of packet_buffer. */
+	int (*write)(struct cmsis_dap *dap, int txlen);
+};
+
 struct pending_transfer_result {
 	uint8_t cmd;
 	uint32_t data;
@@ -181,6 +211,9 @@ struct pending_transfer_result {
 struct pending_request_block {
 	struct pending_transfer_result *transfers;
 	int transfer_count;
+	/* CMD_DAP_TFER, or CMD_DAP_TFER_BLOCK when all transfers
+	 * access one register */
+	uint8_t command;
 };
 
 struct pending_scan_result {
@@ -199,8 +232,10 @@ struct pending_scan_result {
 #define MAX_PENDING_REQUESTS 3
 
 /* Pending requests are organized as a FIFO - circular buffer */
-/* Each block in FIFO can contain up to pending_queue_len transfers */
+/* Each block in FIFO can contain up to pending_queue_len transfers,
+ * or pending_block_len if it is sent as a DAP_TransferBlock */
 static int pending_queue_len;
+static int pending_block_len;
 static struct pending_request_block pending_fifo[MAX_PENDING_REQUESTS];
 static int pending_fifo_put_idx, pending_fifo_get_idx;
 static int pending_fifo_block_count;
@@ -211,7 +246,7 @@ static int pending_scan_result_count;
 static struct pending_scan_result pending_scan_results[MAX_PENDING_SCAN_RESULTS];
 
 /* queued JTAG sequences that will be executed on the next flush */
-#define QUEUED_SEQ_BUF_LEN (cmsis_dap_handle->packet_size - 3)
+#define QUEUED_SEQ_BUF_LEN MIN(cmsis_dap_handle->packet_size - 3, (int)sizeof(queued_seq_buf))
 static int queued_seq_count;
 static int queued_seq_buf_end;
 static int queued_seq_tdo_ptr;
@@ -223,7 +258,7 @@ static uint8_t output_pins = SWJ_PIN_SRST | SWJ_PIN_TRST;
 
 static struct cmsis_dap *cmsis_dap_handle;
 
-static int cmsis_dap_usb_open(void)
+static int cmsis_dap_hid_open(struct cmsis_dap *dap)
 {
 	hid_device *dev = NULL;
 	int i;
@@ -311,24 +346,14 @@ static int cmsis_dap_usb_open(void)
 		return ERROR_FAIL;
 	}
 
-	struct cmsis_dap *dap = malloc(sizeof(struct cmsis_dap));
-	if (dap == NULL) {
-		LOG_ERROR("unable to allocate memory");
-		return ERROR_FAIL;
-	}
-
 	dap->dev_handle = dev;
-	dap->caps = 0;
-	dap->mode = 0;
-
-	cmsis_dap_handle = dap;
 
 	/* allocate default packet buffer, may be changed later.
 	 * currently with HIDAPI we have no way of getting the output report length
 	 * without this info we cannot communicate with the adapter.
 	 * For the moment we ahve to hard code the packet size */
 
-	int packet_size = PACKET_SIZE;
+	dap->packet_size = PACKET_SIZE;
 
 	/* atmel cmsis-dap uses 512 byte reports */
 	/* except when it doesn't e.g. with mEDBG on SAMD10 Xplained
@@ -336,23 +361,282 @@ static int cmsis_dap_usb_open(void)
 	/* TODO: HID report descriptor should be parsed instead of
 	 * hardcoding a match by VID */
 	if (target_vid == 0x03eb && target_pid != 0x2145)
-		packet_size = 512 + 1;
+		dap->packet_size = 512 + 1;
+
+	return ERROR_OK;
+}
+
+static void cmsis_dap_hid_close(struct cmsis_dap *dap)
+{
+	hid_close(dap->dev_handle);
+	hid_exit();
+	dap->dev_handle = NULL;
+}
+
+static int cmsis_dap_hid_read(struct cmsis_dap *dap, int timeout_ms)
+{
+	int retval = hid_read_timeout(dap->dev_handle, dap->packet_buffer, dap->packet_size, timeout_ms);
+	if (retval == -1)
+		LOG_DEBUG("error reading data: %ls", hid_error(dap->dev_handle));
+
+	return retval;
+}
+
+static int cmsis_dap_hid_write(struct cmsis_dap *dap, int txlen)
+{
+	/* Pad the rest of the TX buffer with 0's */
+	memset(dap->packet_buffer + txlen, 0, dap->packet_size - txlen);
+
+	/* write data to device */
+	int retval = hid_write(dap->dev_handle, dap->packet_buffer, dap->packet_size);
+	if (retval == -1) {
+		LOG_ERROR("error writing data: %ls", hid_error(dap->dev_handle));
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
+static const struct cmsis_dap_backend cmsis_dap_hid_backend = {
+	.name = "hid",
+	.open = cmsis_dap_hid_open,
+	.close = cmsis_dap_hid_close,
+	.read = cmsis_dap_hid_read,
+	.write = cmsis_dap_hid_write,
+};
+
+#ifdef HAVE_LIBUSB1
+static bool cmsis_dap_bulk_string_matches(libusb_device_handle *handle,
+		uint8_t index, const char *needle, const wchar_t *wide)
+{
+	char str[256];
+
+	if (!index)
+		return false;
+
+	if (libusb_get_string_descriptor_ascii(handle, index, (unsigned char *)str, sizeof(str)) < 0)
+		return false;
+
+	if (needle)
+		return strstr(str, needle) != NULL;
+
+	wchar_t wstr[256];
+	if (mbstowcs(wstr, str, ARRAY_SIZE(wstr)) == (size_t)-1)
+		return false;
+	return wcscmp(wstr, wide) == 0;
+}
+
+/*
+ * Find the CMSIS-DAP v2 interface of a device: vendor class, its first
+ * endpoint bulk OUT and its second one bulk IN (a third, optional one
+ * carries SWO).
+ */
+static const struct libusb_interface_descriptor *cmsis_dap_bulk_find_interface(
+		const struct libusb_config_descriptor *config)
+{
+	for (int i = 0; i < config->bNumInterfaces; i++) {
+		const struct libusb_interface *intf = &config->interface[i];
+		if (intf->num_altsetting < 1)
+			continue;
+
+		const struct libusb_interface_descriptor *desc = &intf->altsetting[0];
+		if (desc->bInterfaceClass != LIBUSB_CLASS_VENDOR_SPEC || desc->bNumEndpoints < 2)
+			continue;
+
+		const struct libusb_endpoint_descriptor *ep = desc->endpoint;
+		if ((ep[0].bmAttributes & 3) != LIBUSB_TRANSFER_TYPE_BULK ||
+				(ep[0].bEndpointAddress & LIBUSB_ENDPOINT_IN) ||
+				(ep[1].bmAttributes & 3) != LIBUSB_TRANSFER_TYPE_BULK ||
+				!(ep[1].bEndpointAddress & LIBUSB_ENDPOINT_IN))
+			continue;
+
+		return desc;
+	}
+
+	return NULL;
+}
+
+static int cmsis_dap_bulk_open(struct cmsis_dap *dap)
+{
+	libusb_context *ctx;
+	libusb_device **list;
+	int retval = ERROR_FAIL;
+
+	if (libusb_init(&ctx) != LIBUSB_SUCCESS)
+		return ERROR_FAIL;
+
+	ssize_t count = libusb_get_device_list(ctx, &list);
+	for (ssize_t n = 0; n < count && retval != ERROR_OK; n++) {
+		struct libusb_device_descriptor dev_desc;
+		if (libusb_get_device_descriptor(list[n], &dev_desc) != LIBUSB_SUCCESS)
+			continue;
+
+		if (cmsis_dap_vid[0] || cmsis_dap_pid[0]) {
+			int i;
+			for (i = 0; cmsis_dap_vid[i] || cmsis_dap_pid[i]; i++) {
+				if (cmsis_dap_vid[i] == dev_desc.idVendor && cmsis_dap_pid[i] == dev_desc.idProduct)
+					break;
+			}
+			if (!cmsis_dap_vid[i] && !cmsis_dap_pid[i])
+				continue;
+		}
+
+		struct libusb_config_descriptor *config;
+		if (libusb_get_active_config_descriptor(list[n], &config) != LIBUSB_SUCCESS)
+			continue;
+
+		const struct libusb_interface_descriptor *intf = cmsis_dap_bulk_find_interface(config);
+		libusb_device_handle *handle;
+		if (!intf || libusb_open(list[n], &handle) != LIBUSB_SUCCESS) {
+			libusb_free_config_descriptor(config);
+			continue;
+		}
+
+		/* The v2 spec puts "CMSIS-DAP" in the interface string */
+		if (!cmsis_dap_bulk_string_matches(handle, intf->iInterface, "CMSIS-DAP", NULL) ||
+				(cmsis_dap_serial && !cmsis_dap_bulk_string_matches(handle,
+						dev_desc.iSerialNumber, NULL, cmsis_dap_serial)) ||
+				libusb_claim_interface(handle, intf->bInterfaceNumber) != LIBUSB_SUCCESS) {
+			libusb_close(handle);
+			libusb_free_config_descriptor(config);
+			continue;
+		}
+
+		LOG_INFO("CMSIS-DAP: using v2 bulk interface %d of 0x%04x:0x%04x",
+			intf->bInterfaceNumber, dev_desc.idVendor, dev_desc.idProduct);
+
+		dap->usb_ctx = ctx;
+		dap->usb_handle = handle;
+		dap->usb_interface = intf->bInterfaceNumber;
+		dap->ep_out = intf->endpoint[0].bEndpointAddress;
+		dap->ep_in = intf->endpoint[1].bEndpointAddress;
+		/* replaced by INFO_ID_PKT_SZ once connected */
+		dap->packet_size = intf->endpoint[1].wMaxPacketSize + 1;
+		libusb_free_config_descriptor(config);
+		retval = ERROR_OK;
+	}
+
+	if (count >= 0)
+		libusb_free_device_list(list, 1);
+	if (retval != ERROR_OK)
+		libusb_exit(ctx);
+
+	return retval;
+}
+
+static void cmsis_dap_bulk_close(struct cmsis_dap *dap)
+{
+	libusb_release_interface(dap->usb_handle, dap->usb_interface);
+	libusb_close(dap->usb_handle);
+	libusb_exit(dap->usb_ctx);
+	dap->usb_handle = NULL;
+	dap->usb_ctx = NULL;
+}
+
+static int cmsis_dap_bulk_read(struct cmsis_dap *dap, int timeout_ms)
+{
+	int transferred = 0;
+
+	/* libusb treats a zero timeout as infinite; poll briefly instead */
+	int err = libusb_bulk_transfer(dap->usb_handle, dap->ep_in, dap->packet_buffer,
+			dap->packet_size - 1, &transferred, timeout_ms ? timeout_ms : 1);
+	if (err == LIBUSB_ERROR_TIMEOUT && transferred > 0) {
+		/* A reply longer than one USB packet was cut short; fetch the rest */
+		int more = 0;
+		err = libusb_bulk_transfer(dap->usb_handle, dap->ep_in,
+				dap->packet_buffer + transferred, dap->packet_size - 1 - transferred,
+				&more, USB_TIMEOUT);
+		transferred += more;
+	}
+
+	if (err == LIBUSB_ERROR_TIMEOUT)
+		return 0;
+	if (err != LIBUSB_SUCCESS) {
+		LOG_DEBUG("error reading data: %s", libusb_strerror(err));
+		return -1;
+	}
 
-	cmsis_dap_handle->packet_buffer = malloc(packet_size);
-	cmsis_dap_handle->packet_size = packet_size;
+	return transferred;
+}
+
+static int cmsis_dap_bulk_write(struct cmsis_dap *dap, int txlen)
+{
+	int transferred = 0;
+
+	/* skip the HID report number */
+	int err = libusb_bulk_transfer(dap->usb_handle, dap->ep_out, dap->packet_buffer + 1,
+			txlen - 1, &transferred, USB_TIMEOUT);
+	if (err != LIBUSB_SUCCESS || transferred != txlen - 1) {
+		LOG_ERROR("error writing data: %s", libusb_strerror(err));
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
+static const struct cmsis_dap_backend cmsis_dap_bulk_backend = {
+	.name = "usb_bulk",
+	.open = cmsis_dap_bulk_open,
+	.close = cmsis_dap_bulk_close,
+	.read = cmsis_dap_bulk_read,
+	.write = cmsis_dap_bulk_write,
+};
+#endif
 
-	if (cmsis_dap_handle->packet_buffer == NULL) {
+/* In order of preference */
+static const struct cmsis_dap_backend *const cmsis_dap_backends[] = {
+#ifdef HAVE_LIBUSB1
+	&cmsis_dap_bulk_backend,
+#endif
+	&cmsis_dap_hid_backend,
+};
+
+/* Backend forced by cmsis_dap_backend, NULL picks the first that opens */
+static const struct cmsis_dap_backend *cmsis_dap_backend_override;
+
+static int cmsis_dap_usb_open(void)
+{
+	struct cmsis_dap *dap = calloc(1, sizeof(struct cmsis_dap));
+	if (dap == NULL) {
 		LOG_ERROR("unable to allocate memory");
 		return ERROR_FAIL;
 	}
 
+	int retval = ERROR_FAIL;
+	for (unsigned int i = 0; i < ARRAY_SIZE(cmsis_dap_backends); i++) {
+		const struct cmsis_dap_backend *backend = cmsis_dap_backends[i];
+		if (cmsis_dap_backend_override && backend != cmsis_dap_backend_override)
+			continue;
+
+		retval = backend->open(dap);
+		if (retval == ERROR_OK) {
+			LOG_DEBUG("CMSIS-DAP: using %s backend", backend->name);
+			dap->backend = backend;
+			break;
+		}
+	}
+
+	if (retval != ERROR_OK) {
+		free(dap);
+		return retval;
+	}
+
+	dap->packet_buffer = malloc(dap->packet_size);
+	if (dap->packet_buffer == NULL) {
+		LOG_ERROR("unable to allocate memory");
+		dap->backend->close(dap);
+		free(dap);
+		return ERROR_FAIL;
+	}
+
+	cmsis_dap_handle = dap;
+
 	return ERROR_OK;
 }
 
 static void cmsis_dap_usb_close(struct cmsis_dap *dap)
 {
-	hid_close(dap->dev_handle);
-	hid_exit();
+	dap->backend->close(dap);
 
 	free(cmsis_dap_handle->packet_buffer);
 	free(cmsis_dap_handle);
@@ -373,17 +657,7 @@ static int cmsis_dap_usb_write(struct cmsis_dap *dap, int txlen)
 #ifdef CMSIS_DAP_JTAG_DEBUG
 	LOG_DEBUG("cmsis-dap usb xfer cmd=%02X", dap->packet_buffer[1]);
 #endif
-	/* Pad the rest of the TX buffer with 0's */
-	memset(dap->packet_buffer + txlen, 0, dap->packet_size - txlen);
-
-	/* write data to device */
-	int retval = hid_write(dap->dev_handle, dap->packet_buffer, dap->packet_size);
-	if (retval == -1) {
-		LOG_ERROR("error writing data: %ls", hid_error(dap->dev_handle));
-		return ERROR_FAIL;
-	}
-
-	return ERROR_OK;
+	return dap->backend->write(dap, txlen);
 }
 
 /* Send a message and receive the reply */
@@ -392,7 +666,7 @@ static int cmsis_dap_usb_xfer(struct cmsis_dap *dap, int txlen)
 	if (pending_fifo_block_count) {
 		LOG_ERROR("pending %d blocks, flushing", pending_fifo_block_count);
 		while (pending_fifo_block_count) {
-			hid_read_timeout(dap->dev_handle, dap->packet_buffer, dap->packet_size, 10);
+			dap->backend->read(dap, 10);
 			pending_fifo_block_count--;
 		}
 		pending_fifo_put_idx = 0;
@@ -404,9 +678,9 @@ static int cmsis_dap_usb_xfer(struct cmsis_dap *dap, int txlen)
 		return retval;
 
 	/* get reply */
-	retval = hid_read_timeout(dap->dev_handle, dap->packet_buffer, dap->packet_size, USB_TIMEOUT);
+	retval = dap->backend->read(dap, USB_TIMEOUT);
 	if (retval == -1 || retval == 0) {
-		LOG_DEBUG("error reading data: %ls", hid_error(dap->dev_handle));
+		LOG_DEBUG("no reply from CMSIS-DAP");
 		return ERROR_FAIL;
 	}
 
@@ -646,8 +920,30 @@ static void cmsis_dap_swd_write_from_queue(struct cmsis_dap *dap)
 
 	size_t idx = 0;
 	buffer[idx++] = 0;	/* report number */
-	buffer[idx++] = CMD_DAP_TFER;
+	buffer[idx++] = block->command;
 	buffer[idx++] = 0x00;	/* DAP Index */
+
+	if (block->command == CMD_DAP_TFER_BLOCK) {
+		/* One request byte for all transfers, then the write data */
+		uint8_t cmd = block->transfers[0].cmd;
+
+		LOG_DEBUG_IO("%s %s reg %x block of %d",
+				cmd & SWD_CMD_APnDP ? "AP" : "DP",
+				cmd & SWD_CMD_RnW ? "read" : "write",
+			  (cmd & SWD_CMD_A32) >> 1, block->transfer_count);
+
+		h_u16_to_le(&buffer[idx], block->transfer_count);
+		idx += 2;
+		buffer[idx++] = (cmd >> 1) & 0x0f;
+		if (!(cmd & SWD_CMD_RnW)) {
+			for (int i = 0; i < block->transfer_count; i++) {
+				h_u32_to_le(&buffer[idx], block->transfers[i].data);
+				idx += 4;
+			}
+		}
+		goto send;
+	}
+
 	buffer[idx++] = block->transfer_count;
 
 	for (int i = 0; i < block->transfer_count; i++) {
@@ -688,6 +984,7 @@ static void cmsis_dap_swd_write_from_queue(struct cmsis_dap *dap)
 		}
 	}
 
+send:
 	queued_retval = cmsis_dap_usb_write(dap, idx);
 	if (queued_retval != ERROR_OK)
 		goto skip;
@@ -712,36 +1009,51 @@ static void cmsis_dap_swd_read_process(struct cmsis_dap *dap, int timeout_ms)
 		LOG_ERROR("no pending write");
 
 	/* get reply */
-	int retval = hid_read_timeout(dap->dev_handle, dap->packet_buffer, dap->packet_size, timeout_ms);
+	int retval = dap->backend->read(dap, timeout_ms);
 	if (retval == 0 && timeout_ms < USB_TIMEOUT)
 		return;
 
 	if (retval == -1 || retval == 0) {
-		LOG_DEBUG("error reading data: %ls", hid_error(dap->dev_handle));
+		LOG_DEBUG("no reply from CMSIS-DAP");
 		queued_retval = ERROR_FAIL;
 		goto skip;
 	}
 
-	if (buffer[2] & 0x08) {
-		LOG_DEBUG("CMSIS-DAP Protocol Error @ %d (wrong parity)", buffer[1]);
+	/* DAP_TransferBlock has a 16 bit transfer count */
+	int count;
+	uint8_t response;
+	size_t idx;
+	if (block->command == CMD_DAP_TFER_BLOCK) {
+		count = le_to_h_u16(&buffer[1]);
+		response = buffer[3];
+		idx = 4;
+	} else {
+		count = buffer[1];
+		response = buffer[2];
+		idx = 3;
+	}
+
+	if (response & 0x08) {
+		LOG_DEBUG("CMSIS-DAP Protocol Error @ %d (wrong parity)", count);
 		queued_retval = ERROR_FAIL;
 		goto skip;
 	}
-	uint8_t ack = buffer[2] & 0x07;
+	uint8_t ack = response & 0x07;
 	if (ack != SWD_ACK_OK) {
-		LOG_DEBUG("SWD ack not OK @ %d %s", buffer[1],
+		LOG_DEBUG("SWD ack not OK @ %d %s", count,
 			  ack == SWD_ACK_WAIT ? "WAIT" : ack == SWD_ACK_FAULT ? "FAULT" : "JUNK");
 		queued_retval = ack == SWD_ACK_WAIT ? ERROR_WAIT : ERROR_FAIL;
 		goto skip;
 	}
 
-	if (block->transfer_count != buffer[1])
+	if (block->transfer_count != count) {
 		LOG_ERROR("CMSIS-DAP transfer count mismatch: expected %d, got %d",
-			  block->transfer_count, buffer[1]);
+			  block->transfer_count, count);
+		count = MIN(count, block->transfer_count);
+	}
 
-	LOG_DEBUG_IO("Received results of %d queued transactions FIFO index %d", buffer[1], pending_fifo_get_idx);
-	size_t idx = 3;
-	for (int i = 0; i < buffer[1]; i++) {
+	LOG_DEBUG_IO("Received results of %d queued transactions FIFO index %d", count, pending_fifo_get_idx);
+	for (int i = 0; i < count; i++) {
 		struct pending_transfer_result *transfer = &(block->transfers[i]);
 		if (transfer->cmd & SWD_CMD_RnW) {
 			static uint32_t last_read;
@@ -788,9 +1100,17 @@ static int cmsis_dap_swd_run_queue(void)
 	return retval;
 }
 
-static void cmsis_dap_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data)
+static void cmsis_dap_swd_queue_cmd(uint8_t command, uint8_t cmd, uint32_t *dst, uint32_t data)
 {
-	if (pending_fifo[pending_fifo_put_idx].transfer_count == pending_queue_len) {
+	struct pending_request_block *block = &pending_fifo[pending_fifo_put_idx];
+	int queue_len = command == CMD_DAP_TFER_BLOCK ? pending_block_len : pending_queue_len;
+
+	/* A DAP_TransferBlock carries only one register, it can be neither
+	 * mixed with other registers nor with DAP_Transfer requests */
+	bool mismatch = block->transfer_count && (block->command != command ||
+			(command == CMD_DAP_TFER_BLOCK && block->transfers[0].cmd != cmd));
+
+	if (block->transfer_count >= queue_len || mismatch) {
 		if (pending_fifo_block_count)
 			cmsis_dap_swd_read_process(cmsis_dap_handle, 0);
 
@@ -804,7 +1124,8 @@ static void cmsis_dap_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data)
 	if (queued_retval != ERROR_OK)
 		return;
 
-	struct pending_request_block *block = &pending_fifo[pending_fifo_put_idx];
+	block = &pending_fifo[pending_fifo_put_idx];
+	block->command = command;
 	struct pending_transfer_result *transfer = &(block->transfers[block->transfer_count]);
 	transfer->data = data;
 	transfer->cmd = cmd;
@@ -818,13 +1139,29 @@ static void cmsis_dap_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data)
 static void cmsis_dap_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_clk)
 {
 	assert(!(cmd & SWD_CMD_RnW));
-	cmsis_dap_swd_queue_cmd(cmd, NULL, value);
+	cmsis_dap_swd_queue_cmd(CMD_DAP_TFER, cmd, NULL, value);
 }
 
 static void cmsis_dap_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay_clk)
 {
 	assert(cmd & SWD_CMD_RnW);
-	cmsis_dap_swd_queue_cmd(cmd, value, 0);
+	cmsis_dap_swd_queue_cmd(CMD_DAP_TFER, cmd, value, 0);
+}
+
+static void cmsis_dap_swd_write_reg_block(uint8_t cmd, const uint32_t *values, unsigned int count,
+		uint32_t ap_delay_clk)
+{
+	assert(!(cmd & SWD_CMD_RnW));
+	for (unsigned int i = 0; i < count; i++)
+		cmsis_dap_swd_queue_cmd(CMD_DAP_TFER_BLOCK, cmd, NULL, values[i]);
+}
+
+static void cmsis_dap_swd_read_reg_block(uint8_t cmd, uint32_t *values, unsigned int count,
+		uint32_t ap_delay_clk)
+{
+	assert(cmd & SWD_CMD_RnW);
+	for (unsigned int i = 0; i < count; i++)
+		cmsis_dap_swd_queue_cmd(CMD_DAP_TFER_BLOCK, cmd, &values[i], 0);
 }
 
 static int cmsis_dap_get_serial_info(void)
@@ -1011,6 +1348,7 @@ static int cmsis_dap_init(void)
 	 * until we get packet count info from the adaptor */
 	cmsis_dap_handle->packet_count = 1;
 	pending_queue_len = 12;
+	pending_block_len = 14;
 
 	/* INFO_ID_PKT_SZ - short */
 	retval = cmsis_dap_cmd_DAP_Info(INFO_ID_PKT_SZ, &data);
@@ -1021,9 +1359,10 @@ static int cmsis_dap_init(void)
 		uint16_t pkt_sz = data[1] + (data[2] << 8);
 
 		/* 4 bytes of command header + 5 bytes per register
-		 * write. For bulk read sequences just 4 bytes are
-		 * needed per transfer, so this is suboptimal. */
+		 * write. DAP_TransferBlock has a 5 byte header and
+		 * needs just 4 bytes per transfer either way. */
 		pending_queue_len = (pkt_sz - 4) / 5;
+		pending_block_len = (pkt_sz - 5) / 4;
 
 		if (cmsis_dap_handle->packet_size != pkt_sz + 1) {
 			/* reallocate buffer */
@@ -1052,9 +1391,10 @@ static int cmsis_dap_init(void)
 		LOG_DEBUG("CMSIS-DAP: Packet Count = %d", pkt_cnt);
 	}
 
-	LOG_DEBUG("Allocating FIFO for %d pending HID requests", cmsis_dap_handle->packet_count);
+	LOG_DEBUG("Allocating FIFO for %d pending requests", cmsis_dap_handle->packet_count);
 	for (int i = 0; i < cmsis_dap_handle->packet_count; i++) {
-		pending_fifo[i].transfers = malloc(pending_queue_len * sizeof(struct pending_transfer_result));
+		pending_fifo[i].transfers = malloc(MAX(pending_queue_len, pending_block_len)
+				* sizeof(struct pending_transfer_result));
 		if (!pending_fifo[i].transfers) {
 			LOG_ERROR("Unable to allocate memory for CMSIS-DAP queue");
 			return ERROR_FAIL;
@@ -1733,6 +2073,27 @@ COMMAND_HANDLER(cmsis_dap_handle_serial_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(cmsis_dap_handle_backend_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (strcmp(CMD_ARGV[0], "auto") == 0) {
+		cmsis_dap_backend_override = NULL;
+		return ERROR_OK;
+	}
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(cmsis_dap_backends); i++) {
+		if (strcmp(CMD_ARGV[0], cmsis_dap_backends[i]->name) == 0) {
+			cmsis_dap_backend_override = cmsis_dap_backends[i];
+			return ERROR_OK;
+		}
+	}
+
+	LOG_ERROR("invalid or unsupported backend '%s'", CMD_ARGV[0]);
+	return ERROR_COMMAND_ARGUMENT_INVALID;
+}
+
 static const struct command_registration cmsis_dap_subcommand_handlers[] = {
 	{
 		.name = "info",
@@ -1773,6 +2134,13 @@ static const struct command_registration cmsis_dap_command_handlers[] = {
 		.help = "set the serial number of the adapter",
 		.usage = "serial_string",
 	},
+	{
+		.name = "cmsis_dap_backend",
+		.handler = &cmsis_dap_handle_backend_command,
+		.mode = COMMAND_CONFIG,
+		.help = "set the communication backend to use (USB bulk or HID)",
+		.usage = "(auto | usb_bulk | hid)",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -1781,6 +2149,8 @@ static const struct swd_driver cmsis_dap_swd_driver = {
 	.switch_seq = cmsis_dap_swd_switch_seq,
 	.read_reg = cmsis_dap_swd_read_reg,
 	.write_reg = cmsis_dap_swd_write_reg,
+	.read_reg_block = cmsis_dap_swd_read_reg_block,
+	.write_reg_block = cmsis_dap_swd_write_reg_block,
 	.run = cmsis_dap_swd_run_queue,
 };
 
@@ -886,8 +886,6 @@ static int syncbb_execute_queue(void)
 				syncbb_scan(cmd->cmd.scan->ir_scan, type, buffer, scan_size);
 				if (jtag_read_buffer(buffer, cmd->cmd.scan) != ERROR_OK)
 					retval = ERROR_JTAG_QUEUE_FAILED;
-				if (buffer)
-					free(buffer);
 				break;
 
 			case JTAG_SLEEP:
@@ -49,6 +49,10 @@
 #define CMD_SCAN_CHAIN_FLIP_TMS	3
 #define CMD_STOP_SIMU		4
 
+/* Scan commands that may be in flight before their echoes are collected.
+ * Bounded so that neither side can block on a full socket buffer. */
+#define JTAG_VPI_MAX_IN_FLIGHT	32
+
 /* jtag_vpi server port and address to connect to */
 static int server_port = SERVER_PORT;
 static char *server_address;
@@ -56,9 +60,26 @@ static char *server_address;
 /* Send CMD_STOP_SIMU to server when OpenOCD exits? */
 static bool stop_sim_on_exit;
 
+/* Stream commands without waiting for each scan echo? */
+static bool pipelined;
+
 static int sockfd;
 static struct sockaddr_in serv_addr;
 
+/* Scan commands sent in pipelined mode whose echo has not been read yet,
+ * in the order they were sent. */
+static struct {
+	uint8_t *bits;
+	int nb_bits;
+} in_flight[JTAG_VPI_MAX_IN_FLIGHT];
+static unsigned int in_flight_count;
+
+/* Scans whose captured bits are handed back once all echoes are in. */
+static struct scan_command **deferred_scans;
+static uint8_t **deferred_bufs;
+static unsigned int deferred_count;
+static unsigned int deferred_size;
+
 /* One jtag_vpi "packet" as sent over a TCP channel. */
 struct vpi_cmd {
 	union {
@@ -301,6 +322,94 @@ static int jtag_vpi_state_move(tap_state_t state)
 	return ERROR_OK;
 }
 
+static void jtag_vpi_store_tdo(const struct vpi_cmd *vpi, uint8_t *bits, int nb_bits)
+{
+	/* Optional low-level JTAG debug */
+	if (LOG_LEVEL_IS(LOG_LVL_DEBUG_IO)) {
+		char *char_buf = buf_to_str(vpi->buffer_in,
+				(nb_bits > DEBUG_JTAG_IOZ) ? DEBUG_JTAG_IOZ : nb_bits,
+				16);
+		LOG_DEBUG_IO("recvd JTAG VPI data: nb_bits=%d, buf_in=0x%s%s",
+			nb_bits, char_buf, (nb_bits > DEBUG_JTAG_IOZ) ? "(...)" : "");
+		free(char_buf);
+	}
+
+	if (bits)
+		memcpy(bits, vpi->buffer_in, DIV_ROUND_UP(nb_bits, 8));
+}
+
+/**
+ * jtag_vpi_collect - read the echoes of all scans sent in pipelined mode
+ *
+ * The server answers scan commands in the order it received them, so the
+ * echoes are matched against the in-flight list front to back. On an error
+ * both the in-flight and the deferred scans are dropped.
+ */
+static int jtag_vpi_collect(void)
+{
+	struct vpi_cmd vpi;
+
+	for (unsigned int i = 0; i < in_flight_count; i++) {
+		int retval = jtag_vpi_receive_cmd(&vpi);
+		if (retval != ERROR_OK) {
+			/* The echoes are out of step now, forget everything
+			 * that was waiting for them so that the next queue
+			 * doesn't match its replies against stale entries. */
+			in_flight_count = 0;
+			deferred_count = 0;
+			return retval;
+		}
+
+		jtag_vpi_store_tdo(&vpi, in_flight[i].bits, in_flight[i].nb_bits);
+	}
+	in_flight_count = 0;
+
+	return ERROR_OK;
+}
+
+static int jtag_vpi_defer_read(uint8_t *buf, struct scan_command *cmd)
+{
+	if (deferred_count == deferred_size) {
+		unsigned int size = deferred_size ? 2 * deferred_size : 64;
+		struct scan_command **scans = realloc(deferred_scans, size * sizeof(*scans));
+		if (!scans)
+			return ERROR_FAIL;
+		deferred_scans = scans;
+		uint8_t **bufs = realloc(deferred_bufs, size * sizeof(*bufs));
+		if (!bufs)
+			return ERROR_FAIL;
+		deferred_bufs = bufs;
+		deferred_size = size;
+	}
+
+	deferred_scans[deferred_count] = cmd;
+	deferred_bufs[deferred_count] = buf;
+	deferred_count++;
+
+	return ERROR_OK;
+}
+
+/**
+ * jtag_vpi_flush - wait for all commands sent so far
+ *
+ * Collects outstanding echoes and fills in the fields of the scans that were
+ * deferred, in queue order. The scan buffers come from the command queue and
+ * stay valid until it is freed, after execute_queue returns.
+ */
+static int jtag_vpi_flush(void)
+{
+	int retval = jtag_vpi_collect();
+
+	for (unsigned int i = 0; i < deferred_count; i++) {
+		int ret = jtag_read_buffer(deferred_bufs[i], deferred_scans[i]);
+		if (retval == ERROR_OK)
+			retval = ret;
+	}
+	deferred_count = 0;
+
+	return retval;
+}
+
 static int jtag_vpi_queue_tdi_xfer(uint8_t *bits, int nb_bits, int tap_shift)
 {
 	struct vpi_cmd vpi;
@@ -322,22 +431,20 @@ static int jtag_vpi_queue_tdi_xfer(uint8_t *bits, int nb_bits, int tap_shift)
 	if (retval != ERROR_OK)
 		return retval;
 
+	if (pipelined) {
+		in_flight[in_flight_count].bits = bits;
+		in_flight[in_flight_count].nb_bits = nb_bits;
+		in_flight_count++;
+		if (in_flight_count == JTAG_VPI_MAX_IN_FLIGHT)
+			return jtag_vpi_collect();
+		return ERROR_OK;
+	}
+
 	retval = jtag_vpi_receive_cmd(&vpi);
 	if (retval != ERROR_OK)
 		return retval;
 
-	/* Optional low-level JTAG debug */
-	if (LOG_LEVEL_IS(LOG_LVL_DEBUG_IO)) {
-		char *char_buf = buf_to_str(vpi.buffer_in,
-				(nb_bits > DEBUG_JTAG_IOZ) ? DEBUG_JTAG_IOZ : nb_bits,
-				16);
-		LOG_DEBUG_IO("recvd JTAG VPI data: nb_bits=%d, buf_in=0x%s%s",
-			nb_bits, char_buf, (nb_bits > DEBUG_JTAG_IOZ) ? "(...)" : "");
-		free(char_buf);
-	}
-
-	if (bits)
-		memcpy(bits, vpi.buffer_in, nb_bytes);
+	jtag_vpi_store_tdo(&vpi, bits, nb_bits);
 
 	return ERROR_OK;
 }
@@ -437,13 +544,13 @@ static int jtag_vpi_scan(struct scan_command *cmd)
 			tap_set_state(TAP_DRPAUSE);
 	}
 
-	retval = jtag_read_buffer(buf, cmd);
+	if (pipelined)
+		retval = jtag_vpi_defer_read(buf, cmd);
+	else
+		retval = jtag_read_buffer(buf, cmd);
 	if (retval != ERROR_OK)
 		return retval;
 
-	if (buf)
-		free(buf);
-
 	if (cmd->end_state != TAP_DRSHIFT) {
 		retval = jtag_vpi_state_move(cmd->end_state);
 		if (retval != ERROR_OK)
@@ -521,6 +628,8 @@ static int jtag_vpi_execute_queue(void)
 			retval = jtag_vpi_tms(cmd->cmd.tms);
 			break;
 		case JTAG_SLEEP:
+			/* The delay is relative to the commands before it. */
+			retval = jtag_vpi_flush();
 			jtag_sleep(cmd->cmd.sleep->us);
 			break;
 		case JTAG_SCAN:
@@ -534,6 +643,12 @@ static int jtag_vpi_execute_queue(void)
 		}
 	}
 
+	/* Always drain the socket, even after an error, so that the next
+	 * queue doesn't pick up stale echoes. */
+	int flush_retval = jtag_vpi_flush();
+	if (retval == ERROR_OK)
+		retval = flush_retval;
+
 	return retval;
 }
 
@@ -601,6 +716,8 @@ static int jtag_vpi_quit(void)
 		log_socket_error("jtag_vpi");
 	}
 	free(server_address);
+	free(deferred_scans);
+	free(deferred_bufs);
 	return ERROR_OK;
 }
 
@@ -642,6 +759,17 @@ COMMAND_HANDLER(jtag_vpi_stop_sim_on_exit_handler)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(jtag_vpi_pipeline_handler)
+{
+	if (CMD_ARGC != 1) {
+		LOG_ERROR("jtag_vpi_pipeline expects 1 argument (on|off)");
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	} else {
+		COMMAND_PARSE_ON_OFF(CMD_ARGV[0], pipelined);
+	}
+	return ERROR_OK;
+}
+
 static const struct command_registration jtag_vpi_command_handlers[] = {
 	{
 		.name = "jtag_vpi_set_port",
@@ -665,6 +793,14 @@ static const struct command_registration jtag_vpi_command_handlers[] = {
 			"before OpenOCD exits (default: off)",
 		.usage = "<on|off>",
 	},
+	{
+		.name = "jtag_vpi_pipeline",
+		.handler = &jtag_vpi_pipeline_handler,
+		.mode = COMMAND_CONFIG,
+		.help = "Configure if commands are streamed to the server without "
+			"waiting for each scan to complete (default: off)",
+		.usage = "<on|off>",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -696,9 +696,6 @@ int opendous_tap_execute(void)
 				opendous_tap_init();
 				return ERROR_JTAG_QUEUE_FAILED;
 			}
-
-			if (pending_scan_result->buffer != NULL)
-				free(pending_scan_result->buffer);
 		}
 
 		opendous_tap_init();
@@ -21,6 +21,7 @@
 
 #include <jtag/interface.h>
 #include <jtag/swd.h>
+#include <helper/types.h>
 #include <stdio.h>
 #include <asm-generic/termbits.h>
 #include <asm-generic/ioctls.h>
@@ -49,6 +50,103 @@ static FILE *dbg;
 		fprintf(dev, "\n");			\
 	}
 
+/* Binary mode.  After negotiation in pdap_init() both directions
+   switch from text lines to fixed size records:
+
+   request:  op, arg, seq (le16), value (le32)
+   response: type, ack, seq (le16), value (le32)
+
+   The sequence number is incremented per request and echoed in the
+   response.  It takes over the role of the text mode sync counter:
+   every reply is checked against the request it belongs to.
+
+   Version 2 adds block transfers to one register.  The request value
+   holds the count in the low and ap_delay_clk in the high half word.
+   The data words of a block write follow the request, those of a
+   block read follow a PDAP_RSP_BLOCK header carrying the count.  Data
+   words are packed two per record, padded to a whole record. */
+#define PDAP_REC_SIZE 8
+#define PDAP_MAX_BLOCK 256
+
+enum pdap_op {
+	PDAP_OP_RD      = 1,  /* arg: swd cmd, value: ap_delay_clk */
+	PDAP_OP_RD_DROP = 2,  /* same, no reply */
+	PDAP_OP_WR      = 3,  /* arg: swd cmd, value: data */
+	PDAP_OP_IDLE    = 4,  /* value: clocks */
+	PDAP_OP_SEQ     = 5,  /* arg: enum swd_special_seq */
+	PDAP_OP_SRST    = 6,  /* arg: level */
+	PDAP_OP_SYNC    = 7,
+	PDAP_OP_RD_BLOCK = 8, /* arg: swd cmd, value: count, ap_delay_clk */
+	PDAP_OP_WR_BLOCK = 9, /* same, followed by the data */
+};
+
+enum pdap_rsp {
+	PDAP_RSP_VAL    = 1,
+	PDAP_RSP_ERR    = 2,  /* ack: swd ack */
+	PDAP_RSP_SYNC   = 3,
+	PDAP_RSP_BLOCK  = 4,  /* value: count, followed by the data */
+};
+
+static int binary;
+static int bin_version;
+static uint16_t bin_seq;
+
+static uint16_t pdap_bin_req(uint8_t op, uint8_t arg, uint32_t value)
+{
+	uint8_t rec[PDAP_REC_SIZE] = { op, arg };
+	h_u16_to_le(rec + 2, bin_seq);
+	h_u32_to_le(rec + 4, value);
+	DBG("  %d %x %04x %x", op, arg, bin_seq, value);
+	fwrite(rec, sizeof(rec), 1, dev);
+	return bin_seq++;
+}
+
+static uint16_t pdap_bin_req_block(uint8_t op, uint8_t arg, unsigned int count,
+				   uint32_t ap_delay_clk, const uint32_t *values)
+{
+	uint16_t seq = pdap_bin_req(op, arg,
+				    count | (MIN(ap_delay_clk, 0xffff) << 16));
+	for (unsigned int i = 0; values && i < count; i += 2) {
+		uint8_t rec[PDAP_REC_SIZE] = {};
+		h_u32_to_le(rec, values[i]);
+		if (i + 1 < count)
+			h_u32_to_le(rec + 4, values[i + 1]);
+		fwrite(rec, sizeof(rec), 1, dev);
+	}
+	return seq;
+}
+
+static int pdap_bin_resp(uint8_t *type, uint8_t *ack,
+			 uint16_t *rseq, uint32_t *value)
+{
+	uint8_t rec[PDAP_REC_SIZE];
+	if (1 != fread(rec, sizeof(rec), 1, dev)) {
+		/* This means the device disappeared. */
+		LOG_ERROR("PDAP EOF");
+		exit(1);
+	}
+	*type = rec[0];
+	*ack = rec[1];
+	*rseq = le_to_h_u16(rec + 2);
+	*value = le_to_h_u32(rec + 4);
+	DBG(". %d %x %04x %x", *type, *ack, *rseq, *value);
+	return ERROR_OK;
+}
+
+static void pdap_bin_resp_words(uint32_t *values, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i += 2) {
+		uint8_t rec[PDAP_REC_SIZE];
+		if (1 != fread(rec, sizeof(rec), 1, dev)) {
+			LOG_ERROR("PDAP EOF");
+			exit(1);
+		}
+		values[i] = le_to_h_u32(rec);
+		if (i + 1 < count)
+			values[i + 1] = le_to_h_u32(rec + 4);
+	}
+}
+
 
 
 int pdap_resp(char *buf, int len)
@@ -91,12 +189,35 @@ int pdap_resp(char *buf, int len)
 static uint32_t nb_transactions;
 static int last_error;
 
+static int pdap_bin_sync(int discard)
+{
+	uint16_t sync = pdap_bin_req(PDAP_OP_SYNC, 0, 0);
+	fflush(dev);
+	for (;;) {
+		uint8_t type, ack;
+		uint16_t rseq;
+		uint32_t value;
+		pdap_bin_resp(&type, &ack, &rseq, &value);
+		if (type == PDAP_RSP_SYNC && rseq == sync)
+			return ERROR_OK;
+		if (!discard) {
+			LOG_ERROR("bad sync: type %d seq %04x != %04x",
+				  type, rseq, sync);
+			return ERROR_FAIL;
+		}
+	}
+}
+
 static int pdap_sync(int discard) {
 	int rv = ERROR_OK;
 
+	if (binary)
+		return pdap_bin_sync(discard);
+
 	/* Just perform synchronization here to make sure we're still
 	 * in lock step. */
 	PDAP("%x sync", nb_transactions);
+	fflush(dev);
 
 	char buf[100] = {};
 
@@ -126,6 +247,45 @@ done:
 
 }
 
+/* Ask the firmware to switch to binary mode.  A firmware that knows
+   about it acknowledges with a "binary <version>" line and switches
+   both directions right after the reply to the sync that follows.
+   Older firmware only produces the sync reply, so we stay in text
+   mode. */
+static int pdap_negotiate_binary(void)
+{
+	int ack = 0;
+	char buf[100] = {};
+
+	PDAP("binary");
+	PDAP("%x sync", nb_transactions);
+	fflush(dev);
+	for (;;) {
+		if (ERROR_FAIL == pdap_resp(buf, sizeof(buf))) {
+			LOG_ERROR("binary negotiation read fail: '%s'", buf);
+			return ERROR_FAIL;
+		}
+		if (!strncmp("binary ", buf, 7)) {
+			ack = 1;
+			bin_version = strtol(buf + 7, NULL, 10);
+			continue;
+		}
+		if (!strncmp("sync ", buf, 5)) {
+			uint32_t sync = strtol(buf + 5, NULL, 16);
+			if (sync != nb_transactions)
+				continue;
+			break;
+		}
+	}
+	nb_transactions++;
+	binary = ack;
+	if (binary)
+		LOG_INFO("PDAP binary mode, version %d", bin_version);
+	else
+		LOG_INFO("PDAP text mode");
+	return ERROR_OK;
+}
+
 int pdap_init(void)
 {
 	/* Called both by swd.init (first), then adapter.init, so just
@@ -172,7 +332,15 @@ int pdap_init(void)
 	PDAP(" ");
 	PDAP("0 echo");
 	PDAP("hex");
-	return pdap_sync(1);
+	int rv = pdap_sync(1);
+	if (rv != ERROR_OK)
+		return rv;
+
+	/* Binary mode is opt-in until all firmware supports it. */
+	const char *mode = getenv("PDAP_MODE");
+	if (mode && !strcmp(mode, "binary"))
+		rv = pdap_negotiate_binary();
+	return rv;
 }
 
 int pdap_quit(void)
@@ -184,12 +352,29 @@ int pdap_quit(void)
 int pdap_reset(int trst, int srst)
 {
 	// needs: reset_config srst_only
-	PDAP("%x srst", srst);
+	if (binary)
+		pdap_bin_req(PDAP_OP_SRST, srst, 0);
+	else
+		PDAP("%x srst", srst);
+	/* Reset is not part of a queue run, so push it out now. */
+	fflush(dev);
 	return ERROR_OK;
 }
 
 int pdap_swd_switch_seq(enum swd_special_seq seq)
 {
+	if (binary) {
+		switch (seq) {
+		case LINE_RESET:
+		case JTAG_TO_SWD:
+		case SWD_TO_JTAG:
+			pdap_bin_req(PDAP_OP_SEQ, seq, 0);
+			return ERROR_OK;
+		default:
+			LOG_ERROR("Sequence %d not supported", seq);
+			return ERROR_FAIL;
+		}
+	}
 	switch (seq) {
 	case LINE_RESET:
 		PDAP("line_reset");
@@ -226,6 +411,69 @@ int pdap_read_resp(uint32_t *pval) {
 }
 
 
+/* Reads are not waited for individually.  The command is sent out
+   and the destination pointer is recorded in the pending list.  All
+   replies are collected in one pass when the queue is run, so a
+   queue costs one round trip instead of one per read. */
+#define PDAP_MAX_PENDING 256
+struct pdap_pending {
+	uint32_t *pval;
+	uint16_t seq;
+	/* Number of words of a block read, 0 for a single read. */
+	uint16_t count;
+};
+static struct pdap_pending pending_reads[PDAP_MAX_PENDING];
+static int pending_count;
+
+static int pdap_bin_read_resp(struct pdap_pending *p)
+{
+	uint8_t type, ack;
+	uint16_t rseq;
+	uint32_t value;
+	pdap_bin_resp(&type, &ack, &rseq, &value);
+	if (rseq != p->seq) {
+		LOG_ERROR("bad seq: %04x != %04x", rseq, p->seq);
+		return ERROR_FAIL;
+	}
+	if (type == PDAP_RSP_ERR) {
+		LOG_ERROR("ack = %d", ack);
+		return ERROR_FAIL;
+	}
+	if (p->count) {
+		if (type != PDAP_RSP_BLOCK || value != p->count) {
+			LOG_ERROR("bad block response type %d count %d", type, value);
+			return ERROR_FAIL;
+		}
+		pdap_bin_resp_words(p->pval, p->count);
+		return ERROR_OK;
+	}
+	if (type != PDAP_RSP_VAL) {
+		LOG_ERROR("bad response type %d", type);
+		return ERROR_FAIL;
+	}
+	LOG_DEBUG("val = 0x%x", value);
+	*p->pval = value;
+	return ERROR_OK;
+}
+
+static void pdap_collect(void)
+{
+	fflush(dev);
+	for (int i = 0; i < pending_count; i++) {
+		struct pdap_pending *p = &pending_reads[i];
+		int rv = binary ?
+			pdap_bin_read_resp(p) :
+			pdap_read_resp(p->pval);
+		if (ERROR_OK != rv) {
+			/* Remaining replies are skipped by the
+			   resynchronization in pdap_swd_run_queue(). */
+			last_error = ERROR_FAIL;
+			break;
+		}
+	}
+	pending_count = 0;
+}
+
 void pdap_swd_read_reg(uint8_t cmd, uint32_t *pval, uint32_t ap_delay_clk)
 {
 	if (last_error != ERROR_OK) {
@@ -233,45 +481,100 @@ void pdap_swd_read_reg(uint8_t cmd, uint32_t *pval, uint32_t ap_delay_clk)
 		   current queue run. */
 		return;
 	}
-	if (pval) {
+	if (binary) {
+		if (pval) {
+			struct pdap_pending *p = &pending_reads[pending_count++];
+			p->pval = pval;
+			p->count = 0;
+			p->seq = pdap_bin_req(PDAP_OP_RD, cmd, ap_delay_clk);
+		}
+		else {
+			pdap_bin_req(PDAP_OP_RD_DROP, cmd, ap_delay_clk);
+		}
+	}
+	else if (pval) {
 		/* 'rd' pushes to stack, 'p' prints hex number. */
 		PDAP("%x rd p", cmd);
+		pending_reads[pending_count++].pval = pval;
 	}
 	else {
 		/* 'rd' pushes to stack, 'drop' discards result
 		   without printing. */
 		PDAP("%x rd drop", cmd);
 	}
-	if (ap_delay_clk) {
+	if (ap_delay_clk && !binary) {
 		PDAP("%x idle", ap_delay_clk);
 	}
-	fflush(dev);
-	if (pval) {
-		if (ERROR_OK != pdap_read_resp(pval)) {
-			goto fail;
-		}
+	if (pending_count == PDAP_MAX_PENDING) {
+		/* Don't let the reply stream grow without bound. */
+		pdap_collect();
 	}
-	last_error = ERROR_OK;
-	return;
-fail:
-	last_error = ERROR_FAIL;
 }
 
 void pdap_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_clk)
 {
+	if (binary) {
+		pdap_bin_req(PDAP_OP_WR, cmd, value);
+		if (ap_delay_clk)
+			pdap_bin_req(PDAP_OP_IDLE, 0, ap_delay_clk);
+		return;
+	}
 	PDAP("%x %x wr", value, cmd);
 	if (ap_delay_clk) {
 		PDAP("%x idle", ap_delay_clk);
 	}
-	fflush(dev);
+}
+
+/* Firmware without block support gets the transfers one by one. */
+void pdap_swd_read_reg_block(uint8_t cmd, uint32_t *values, unsigned int count,
+			     uint32_t ap_delay_clk)
+{
+	if (!binary || bin_version < 2) {
+		for (unsigned int i = 0; i < count; i++)
+			pdap_swd_read_reg(cmd, &values[i], ap_delay_clk);
+		return;
+	}
+	while (count && last_error == ERROR_OK) {
+		unsigned int n = MIN(count, PDAP_MAX_BLOCK);
+		struct pdap_pending *p = &pending_reads[pending_count++];
+		p->pval = values;
+		p->count = n;
+		p->seq = pdap_bin_req_block(PDAP_OP_RD_BLOCK, cmd, n,
+					    ap_delay_clk, NULL);
+		values += n;
+		count -= n;
+		if (pending_count == PDAP_MAX_PENDING)
+			pdap_collect();
+	}
+}
+
+void pdap_swd_write_reg_block(uint8_t cmd, const uint32_t *values, unsigned int count,
+			      uint32_t ap_delay_clk)
+{
+	if (!binary || bin_version < 2) {
+		for (unsigned int i = 0; i < count; i++)
+			pdap_swd_write_reg(cmd, values[i], ap_delay_clk);
+		return;
+	}
+	while (count) {
+		unsigned int n = MIN(count, PDAP_MAX_BLOCK);
+		pdap_bin_req_block(PDAP_OP_WR_BLOCK, cmd, n, ap_delay_clk, values);
+		values += n;
+		count -= n;
+	}
 }
 
 int pdap_swd_run_queue(void)
 {
 	int rv;
 
-	/* Make sure we're still in lock step. */
-	if (ERROR_OK == (rv = pdap_sync(0))) {
+	/* Send the whole batch and match all pending replies. */
+	pdap_collect();
+
+	/* Make sure we're still in lock step.  After a failed read
+	   the rest of the replies are still in the stream, so
+	   discard everything up to the sync reply. */
+	if (ERROR_OK == (rv = pdap_sync(last_error != ERROR_OK))) {
 		rv = last_error;
 	}
 
@@ -286,6 +589,8 @@ const struct swd_driver pdap_swd = {
 	.switch_seq = pdap_swd_switch_seq,
 	.read_reg = pdap_swd_read_reg,
 	.write_reg = pdap_swd_write_reg,
+	.read_reg_block = pdap_swd_read_reg_block,
+	.write_reg_block = pdap_swd_write_reg_block,
 	.run = pdap_swd_run_queue,
 };
 
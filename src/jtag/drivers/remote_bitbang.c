@@ -25,6 +25,8 @@
 #include <netdb.h>
 #endif
 #include <jtag/interface.h>
+#include <jtag/swd.h>
+#include <transport/transport.h>
 #include "bitbang.h"
 
 /* arbitrary limit on host name length: */
@@ -36,6 +38,9 @@ static char *remote_bitbang_port;
 static FILE *remote_bitbang_file;
 static int remote_bitbang_fd;
 
+/* Protocol version negotiated with the server, see remote_bitbang_negotiate() */
+static int remote_bitbang_version;
+
 /* Circular buffer. When start == end, the buffer is empty. */
 static char remote_bitbang_buf[64];
 static unsigned remote_bitbang_start;
@@ -95,8 +100,126 @@ static int remote_bitbang_putc(int c)
 	return ERROR_OK;
 }
 
+/* Blocking read of exactly len bytes of server replies. */
+static int remote_bitbang_read_full(void *buf, size_t len)
+{
+	if (EOF == fflush(remote_bitbang_file)) {
+		LOG_ERROR("fflush: %s", strerror(errno));
+		return ERROR_FAIL;
+	}
+
+	socket_block(remote_bitbang_fd);
+	uint8_t *p = buf;
+	while (len > 0) {
+		ssize_t count = read(remote_bitbang_fd, p, len);
+		if (count <= 0) {
+			LOG_ERROR("read: count=%d, error=%s", (int) count, strerror(errno));
+			return ERROR_FAIL;
+		}
+		p += count;
+		len -= count;
+	}
+	return ERROR_OK;
+}
+
+static int remote_bitbang_write_full(const void *buf, size_t len)
+{
+	if (len && fwrite(buf, len, 1, remote_bitbang_file) != 1) {
+		LOG_ERROR("remote_bitbang: %s", strerror(errno));
+		return ERROR_FAIL;
+	}
+	return ERROR_OK;
+}
+
+/*
+ * Protocol v2: the bitbang writes are not sent one character per edge but
+ * collected into a vector of TMS/TDI bits, one per rising TCK edge, and sent
+ * as a single 'J' message.  TDO samples come back packed as well.
+ */
+#define REMOTE_BITBANG_VEC_BITS 4096
+
+static uint8_t remote_bitbang_vec_tms[REMOTE_BITBANG_VEC_BITS / 8];
+static uint8_t remote_bitbang_vec_tdi[REMOTE_BITBANG_VEC_BITS / 8];
+static unsigned remote_bitbang_vec_bits;
+static int remote_bitbang_vec_tck;
+static bool remote_bitbang_sample_pending;
+
+/* Vector bits whose TDO has to be returned */
+static uint16_t remote_bitbang_vec_samples[REMOTE_BITBANG_VEC_BITS];
+static unsigned remote_bitbang_vec_sample_count;
+
+/* TDO samples received but not yet handed to bitbang.c */
+static uint8_t remote_bitbang_samples[REMOTE_BITBANG_VEC_BITS];
+static unsigned remote_bitbang_samples_start;
+static unsigned remote_bitbang_samples_end;
+
+static int remote_bitbang_vec_flush(void)
+{
+	unsigned bits = remote_bitbang_vec_bits;
+	unsigned bytes = DIV_ROUND_UP(bits, 8);
+	bool capture = remote_bitbang_vec_sample_count > 0;
+
+	if (bits == 0)
+		return ERROR_OK;
+
+	uint8_t hdr[4] = { 'J', capture ? 1 : 0 };
+	h_u16_to_le(hdr + 2, bits);
+	if (remote_bitbang_write_full(hdr, sizeof(hdr)) != ERROR_OK ||
+			remote_bitbang_write_full(remote_bitbang_vec_tms, bytes) != ERROR_OK ||
+			remote_bitbang_write_full(remote_bitbang_vec_tdi, bytes) != ERROR_OK)
+		return ERROR_FAIL;
+
+	remote_bitbang_vec_bits = 0;
+	memset(remote_bitbang_vec_tms, 0, bytes);
+	memset(remote_bitbang_vec_tdi, 0, bytes);
+
+	if (!capture)
+		return ERROR_OK;
+
+	uint8_t tdo[REMOTE_BITBANG_VEC_BITS / 8];
+	if (remote_bitbang_read_full(tdo, bytes) != ERROR_OK)
+		return ERROR_FAIL;
+
+	if (remote_bitbang_samples_start == remote_bitbang_samples_end) {
+		remote_bitbang_samples_start = 0;
+		remote_bitbang_samples_end = 0;
+	}
+	for (unsigned i = 0; i < remote_bitbang_vec_sample_count; i++) {
+		unsigned bit = remote_bitbang_vec_samples[i];
+		assert(remote_bitbang_samples_end < ARRAY_SIZE(remote_bitbang_samples));
+		remote_bitbang_samples[remote_bitbang_samples_end++] = (tdo[bit / 8] >> (bit % 8)) & 1;
+	}
+	remote_bitbang_vec_sample_count = 0;
+
+	return ERROR_OK;
+}
+
+static int remote_bitbang_vec_write(int tck, int tms, int tdi)
+{
+	/* Only rising edges clock the TAP; levels in between don't matter. */
+	if (tck && !remote_bitbang_vec_tck) {
+		unsigned bit = remote_bitbang_vec_bits++;
+		if (tms)
+			remote_bitbang_vec_tms[bit / 8] |= 1 << (bit % 8);
+		if (tdi)
+			remote_bitbang_vec_tdi[bit / 8] |= 1 << (bit % 8);
+		if (remote_bitbang_sample_pending) {
+			remote_bitbang_vec_samples[remote_bitbang_vec_sample_count++] = bit;
+			remote_bitbang_sample_pending = false;
+		}
+	}
+	remote_bitbang_vec_tck = tck;
+
+	if (remote_bitbang_vec_bits == REMOTE_BITBANG_VEC_BITS)
+		return remote_bitbang_vec_flush();
+	return ERROR_OK;
+}
+
 static int remote_bitbang_quit(void)
 {
+	if (remote_bitbang_version >= 2)
+		remote_bitbang_vec_flush();
+
 	if (EOF == fputc('Q', remote_bitbang_file)) {
 		LOG_ERROR("fputs: %s", strerror(errno));
 		return ERROR_FAIL;
@@ -159,6 +282,12 @@ static bb_value_t remote_bitbang_rread(void)
 
 static int remote_bitbang_sample(void)
 {
+	if (remote_bitbang_version >= 2) {
+		/* Taken before the next rising TCK edge */
+		remote_bitbang_sample_pending = true;
+		return ERROR_OK;
+	}
+
 	if (remote_bitbang_fill_buf() != ERROR_OK)
 		return ERROR_FAIL;
 	assert(!remote_bitbang_buf_full());
@@ -167,6 +296,17 @@ static int remote_bitbang_sample(void)
 
 static bb_value_t remote_bitbang_read_sample(void)
 {
+	if (remote_bitbang_version >= 2) {
+		if (remote_bitbang_samples_start == remote_bitbang_samples_end &&
+				remote_bitbang_vec_flush() != ERROR_OK)
+			return BB_ERROR;
+		if (remote_bitbang_samples_start == remote_bitbang_samples_end) {
+			LOG_ERROR("remote_bitbang: read of a TDO sample never taken");
+			return BB_ERROR;
+		}
+		return remote_bitbang_samples[remote_bitbang_samples_start++] ? BB_HIGH : BB_LOW;
+	}
+
 	if (remote_bitbang_start != remote_bitbang_end) {
 		int c = remote_bitbang_buf[remote_bitbang_start];
 		remote_bitbang_start =
@@ -178,18 +318,27 @@ static bb_value_t remote_bitbang_read_sample(void)
 
 static int remote_bitbang_write(int tck, int tms, int tdi)
 {
+	if (remote_bitbang_version >= 2)
+		return remote_bitbang_vec_write(tck, tms, tdi);
+
 	char c = '0' + ((tck ? 0x4 : 0x0) | (tms ? 0x2 : 0x0) | (tdi ? 0x1 : 0x0));
 	return remote_bitbang_putc(c);
 }
 
 static int remote_bitbang_reset(int trst, int srst)
 {
+	if (remote_bitbang_version >= 2 && remote_bitbang_vec_flush() != ERROR_OK)
+		return ERROR_FAIL;
+
 	char c = 'r' + ((trst ? 0x2 : 0x0) | (srst ? 0x1 : 0x0));
 	return remote_bitbang_putc(c);
 }
 
 static int remote_bitbang_blink(int on)
 {
+	if (remote_bitbang_version >= 2 && remote_bitbang_vec_flush() != ERROR_OK)
+		return ERROR_FAIL;
+
 	char c = on ? 'B' : 'b';
 	return remote_bitbang_putc(c);
 }
@@ -202,6 +351,206 @@ static struct bitbang_interface remote_bitbang_bitbang = {
 	.blink = &remote_bitbang_blink,
 };
 
+/*
+ * Protocol v2 SWD: each register access is a single 'W' message, the
+ * server does the whole transfer including turnaround, parity and
+ * retrying WAIT.  Replies are collected when the queue is run.
+ */
+#define REMOTE_BITBANG_SWD_MAX_PENDING 1024
+
+struct remote_bitbang_swd_pending {
+	uint8_t cmd;
+	uint32_t *value;
+};
+
+static struct remote_bitbang_swd_pending remote_bitbang_swd_pending[REMOTE_BITBANG_SWD_MAX_PENDING];
+static unsigned remote_bitbang_swd_pending_count;
+static int remote_bitbang_swd_queued_retval;
+
+/* Read the replies of all queued transfers, in order. */
+static void remote_bitbang_swd_collect(void)
+{
+	for (unsigned i = 0; i < remote_bitbang_swd_pending_count; i++) {
+		struct remote_bitbang_swd_pending *p = &remote_bitbang_swd_pending[i];
+		bool rnw = p->cmd & SWD_CMD_RnW;
+		uint8_t reply[1 + 4 + 1];
+
+		if (remote_bitbang_read_full(reply, rnw ? 6 : 1) != ERROR_OK) {
+			remote_bitbang_swd_queued_retval = ERROR_FAIL;
+			break;
+		}
+
+		int ack = reply[0];
+		uint32_t data = le_to_h_u32(reply + 1);
+		LOG_DEBUG_IO("%s %s %s reg %X = %08" PRIx32,
+			ack == SWD_ACK_OK ? "OK" : ack == SWD_ACK_WAIT ? "WAIT" : ack == SWD_ACK_FAULT ? "FAULT" : "JUNK",
+			p->cmd & SWD_CMD_APnDP ? "AP" : "DP",
+			rnw ? "read" : "write",
+			(p->cmd & SWD_CMD_A32) >> 1,
+			data);
+
+		if (remote_bitbang_swd_queued_retval != ERROR_OK)
+			continue;
+
+		if (ack != SWD_ACK_OK) {
+			remote_bitbang_swd_queued_retval = ack;
+			continue;
+		}
+
+		if (rnw) {
+			if ((reply[5] & 1) != parity_u32(data)) {
+				LOG_DEBUG("Wrong parity detected");
+				remote_bitbang_swd_queued_retval = ERROR_FAIL;
+				continue;
+			}
+			if (p->value)
+				*p->value = data;
+		}
+	}
+
+	remote_bitbang_swd_pending_count = 0;
+}
+
+static void remote_bitbang_swd_queue(uint8_t cmd, uint32_t *dst, uint32_t data, uint32_t ap_delay_clk)
+{
+	if (remote_bitbang_swd_queued_retval != ERROR_OK)
+		return;
+
+	if (remote_bitbang_swd_pending_count == REMOTE_BITBANG_SWD_MAX_PENDING)
+		remote_bitbang_swd_collect();
+
+	cmd |= SWD_CMD_START | SWD_CMD_PARK;
+	uint8_t msg[8] = { 'W', cmd };
+	h_u32_to_le(msg + 2, data);
+	h_u16_to_le(msg + 6, (cmd & SWD_CMD_APnDP) ? MIN(ap_delay_clk, 0xffff) : 0);
+	if (remote_bitbang_write_full(msg, sizeof(msg)) != ERROR_OK) {
+		remote_bitbang_swd_queued_retval = ERROR_FAIL;
+		return;
+	}
+
+	struct remote_bitbang_swd_pending *p = &remote_bitbang_swd_pending[remote_bitbang_swd_pending_count++];
+	p->cmd = cmd;
+	p->value = dst;
+}
+
+static void remote_bitbang_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay_clk)
+{
+	assert(cmd & SWD_CMD_RnW);
+	remote_bitbang_swd_queue(cmd, value, 0, ap_delay_clk);
+}
+
+static void remote_bitbang_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_clk)
+{
+	assert(!(cmd & SWD_CMD_RnW));
+	remote_bitbang_swd_queue(cmd, NULL, value, ap_delay_clk);
+}
+
+/* Clock out raw bits on SWDIO. */
+static int remote_bitbang_swd_sequence(const uint8_t *bits, unsigned len)
+{
+	uint8_t hdr[3] = { 'D' };
+	h_u16_to_le(hdr + 1, len);
+	if (remote_bitbang_write_full(hdr, sizeof(hdr)) != ERROR_OK ||
+			remote_bitbang_write_full(bits, DIV_ROUND_UP(len, 8)) != ERROR_OK)
+		return ERROR_FAIL;
+	return ERROR_OK;
+}
+
+static int remote_bitbang_swd_switch_seq(enum swd_special_seq seq)
+{
+	switch (seq) {
+	case LINE_RESET:
+		LOG_DEBUG("SWD line reset");
+		return remote_bitbang_swd_sequence(swd_seq_line_reset, swd_seq_line_reset_len);
+	case JTAG_TO_SWD:
+		LOG_DEBUG("JTAG-to-SWD");
+		return remote_bitbang_swd_sequence(swd_seq_jtag_to_swd, swd_seq_jtag_to_swd_len);
+	case SWD_TO_JTAG:
+		LOG_DEBUG("SWD-to-JTAG");
+		return remote_bitbang_swd_sequence(swd_seq_swd_to_jtag, swd_seq_swd_to_jtag_len);
+	default:
+		LOG_ERROR("Sequence %d not supported", seq);
+		return ERROR_FAIL;
+	}
+}
+
+static int remote_bitbang_swd_run_queue(void)
+{
+	/* A transaction must be followed by another transaction or at least 8 idle cycles to
+	 * ensure that data is clocked through the AP. */
+	static const uint8_t idle[1];
+	if (remote_bitbang_swd_sequence(idle, 8) != ERROR_OK)
+		remote_bitbang_swd_queued_retval = ERROR_FAIL;
+
+	remote_bitbang_swd_collect();
+
+	int retval = remote_bitbang_swd_queued_retval;
+	remote_bitbang_swd_queued_retval = ERROR_OK;
+	LOG_DEBUG_IO("SWD queue return value: %02x", retval);
+	return retval;
+}
+
+static int remote_bitbang_swd_init(void)
+{
+	/* The protocol version is only known after remote_bitbang_init() */
+	return ERROR_OK;
+}
+
+static const struct swd_driver remote_bitbang_swd = {
+	.init = remote_bitbang_swd_init,
+	.switch_seq = remote_bitbang_swd_switch_seq,
+	.read_reg = remote_bitbang_swd_read_reg,
+	.write_reg = remote_bitbang_swd_write_reg,
+	.run = remote_bitbang_swd_run_queue,
+};
+
+/*
+ * Ask for the protocol version.  A v2 (or later) server answers 'V' with
+ * its version digit.  Older servers ignore 'V', so the 'R' behind it is
+ * what tells them apart: they answer it alone, with '0' or '1'.
+ */
+static int remote_bitbang_negotiate(void)
+{
+	char c;
+
+	remote_bitbang_version = 1;
+
+	if (remote_bitbang_putc('V') != ERROR_OK || remote_bitbang_putc('R') != ERROR_OK)
+		return ERROR_FAIL;
+
+	if (remote_bitbang_read_full(&c, 1) != ERROR_OK)
+		return ERROR_FAIL;
+	if (c == '0' || c == '1')
+		return ERROR_OK;
+	if (c < '2' || c > '9') {
+		LOG_ERROR("remote_bitbang: invalid version response: %c(%i)", c, c);
+		return ERROR_FAIL;
+	}
+
+	/* the reply to 'R' */
+	if (remote_bitbang_read_full(&c, 1) != ERROR_OK)
+		return ERROR_FAIL;
+
+	remote_bitbang_version = 2;
+	remote_bitbang_bitbang.buf_size = REMOTE_BITBANG_VEC_BITS;
+	remote_bitbang_vec_tck = 0;
+	return ERROR_OK;
+}
+
+static int remote_bitbang_execute_queue(void)
+{
+	int retval = bitbang_execute_queue();
+
+	/* Don't leave the tail of the queue sitting in the vector. */
+	if (remote_bitbang_version >= 2) {
+		if (remote_bitbang_vec_flush() != ERROR_OK ||
+				EOF == fflush(remote_bitbang_file))
+			return ERROR_FAIL;
+	}
+
+	return retval;
+}
+
 static int remote_bitbang_init_tcp(void)
 {
 	struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
@@ -295,7 +644,18 @@ static int remote_bitbang_init(void)
 		return ERROR_FAIL;
 	}
 
-	LOG_INFO("remote_bitbang driver initialized");
+	if (remote_bitbang_negotiate() != ERROR_OK) {
+		fclose(remote_bitbang_file);
+		return ERROR_FAIL;
+	}
+
+	if (transport_is_swd() && remote_bitbang_version < 2) {
+		LOG_ERROR("remote_bitbang: SWD needs a protocol v2 server");
+		fclose(remote_bitbang_file);
+		return ERROR_FAIL;
+	}
+
+	LOG_INFO("remote_bitbang driver initialized, protocol v%d", remote_bitbang_version);
 	return ERROR_OK;
 }
 
@@ -342,12 +702,14 @@ static const struct command_registration remote_bitbang_command_handlers[] = {
 };
 
 static struct jtag_interface remote_bitbang_interface = {
-	.execute_queue = &bitbang_execute_queue,
+	.execute_queue = &remote_bitbang_execute_queue,
 };
 
+static const char * const remote_bitbang_transports[] = { "jtag", "swd", NULL };
+
 struct adapter_driver remote_bitbang_adapter_driver = {
 	.name = "remote_bitbang",
-	.transports = jtag_only,
+	.transports = remote_bitbang_transports,
 	.commands = remote_bitbang_command_handlers,
 
 	.init = &remote_bitbang_init,
@@ -355,4 +717,5 @@ struct adapter_driver remote_bitbang_adapter_driver = {
 	.reset = &remote_bitbang_reset,
 
 	.jtag_ops = &remote_bitbang_interface,
+	.swd_ops = &remote_bitbang_swd,
 };
@@ -729,11 +729,10 @@ static int dtc_queue_run(void)
 			}
 
 			if ((rq_p->scan.offset + rq_p->scan.length) >= rq_p->scan.size) {
-				/* feed scan buffer back into openocd and free it */
+				/* feed scan buffer back into openocd */
 				if (jtag_read_buffer(rq_p->scan.buffer,
 						rq_p->cmd->cmd.scan) != ERROR_OK)
 					retval = ERROR_JTAG_QUEUE_FAILED;
-				free(rq_p->scan.buffer);
 			}
 
 			rq_next = rq_p->next;
@@ -1625,14 +1625,10 @@ int ulink_queue_scan(struct ulink *device, struct jtag_command *cmd)
 			bytecount = 0;
 		}
 
-		if (ret != ERROR_OK) {
-			free(tdi_buffer_start);
+		if (ret != ERROR_OK)
 			return ret;
-		}
 	}
 
-	free(tdi_buffer_start);
-
 	/* Set current state to the end state requested by the command */
 	tap_set_state(cmd->cmd.scan->end_state);
 
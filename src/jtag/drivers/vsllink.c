@@ -675,9 +675,6 @@ static int vsllink_jtag_execute(void)
 					vsllink_tap_init();
 					return ERROR_JTAG_QUEUE_FAILED;
 				}
-
-				if (pending_scan_result->buffer != NULL)
-					free(pending_scan_result->buffer);
 			}
 		}
 	} else {
@@ -252,13 +252,13 @@ static int xlnx_pcie_xvc_execute_scan(struct jtag_command *cmd)
 		tap_set_end_state(TAP_IRSHIFT);
 		err = xlnx_pcie_xvc_execute_statemove(0);
 		if (err != ERROR_OK)
-			goto out_err;
+			return err;
 		tap_set_end_state(saved_end_state);
 	} else if (!ir_scan && (tap_get_state() != TAP_DRSHIFT)) {
 		tap_set_end_state(TAP_DRSHIFT);
 		err = xlnx_pcie_xvc_execute_statemove(0);
 		if (err != ERROR_OK)
-			goto out_err;
+			return err;
 		tap_set_end_state(saved_end_state);
 	}
 
@@ -271,7 +271,7 @@ static int xlnx_pcie_xvc_execute_scan(struct jtag_command *cmd)
 		err = xlnx_pcie_xvc_transact(write, tms, tdi, type != SCAN_OUT ?
 					     &tdo : NULL);
 		if (err != ERROR_OK)
-			goto out_err;
+			return err;
 		left -= write;
 		if (type != SCAN_OUT)
 			buf_set_u32(rd_ptr, 0, write, tdo);
@@ -279,18 +279,11 @@ static int xlnx_pcie_xvc_execute_scan(struct jtag_command *cmd)
 	};
 
 	err = jtag_read_buffer(buf, cmd->cmd.scan);
-	if (buf)
-		free(buf);
 
 	if (tap_get_state() != tap_get_end_state())
 		err = xlnx_pcie_xvc_execute_statemove(1);
 
 	return err;
-
-out_err:
-	if (buf)
-		free(buf);
-	return err;
 }
 
 static void xlnx_pcie_xvc_execute_reset(struct jtag_command *cmd)
@@ -304,6 +304,14 @@ int adapter_quit(void);
 /** Set ms to sleep after jtag_execute_queue() flushes queue. Debug purposes. */
 void jtag_set_flush_queue_sleep(int ms);
 
+/**
+ * Enable or disable merging of adjacent queued JTAG commands (continued
+ * scans, runtests, pathmoves) before the queue is passed to the driver.
+ * Enabled by default.
+ */
+void jtag_set_queue_coalesce(bool enable);
+bool jtag_get_queue_coalesce(void);
+
 /**
  * Initialize JTAG chain using only a RESET reset. If init fails,
  * try reset + init.
@@ -253,6 +253,33 @@ struct swd_driver {
 	 */
 	void (*write_reg)(uint8_t cmd, uint32_t value, uint32_t ap_delay_hint);
 
+	/**
+	 * Optional; queued reads of the same AP or DP register, @a count
+	 * times in a row.  Equivalent to calling read_reg() once for each
+	 * element of @a values, so AP reads are still posted.
+	 *
+	 * @param Command byte with APnDP/RnW/addr/parity bits
+	 * @param Where to store the read values
+	 * @param count Number of reads
+	 * @param ap_delay_hint Number of idle cycles that may be
+	 * needed after an AP access to avoid WAITs
+	 */
+	void (*read_reg_block)(uint8_t cmd, uint32_t *values, unsigned int count,
+			uint32_t ap_delay_hint);
+
+	/**
+	 * Optional; queued writes to the same AP or DP register, @a count
+	 * times in a row.  The values are copied before returning.
+	 *
+	 * @param Command byte with APnDP/RnW/addr/parity bits
+	 * @param Values to be written to the register
+	 * @param count Number of writes
+	 * @param ap_delay_hint Number of idle cycles that may be
+	 * needed after an AP access to avoid WAITs
+	 */
+	void (*write_reg_block)(uint8_t cmd, const uint32_t *values, unsigned int count,
+			uint32_t ap_delay_hint);
+
 	/**
 	 * Execute any queued transactions and collect the result.
 	 *
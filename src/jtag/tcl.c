@@ -1228,6 +1228,23 @@ COMMAND_HANDLER(handle_jtag_flush_queue_sleep)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_jtag_queue_coalesce)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		bool enable;
+		COMMAND_PARSE_ON_OFF(CMD_ARGV[0], enable);
+		jtag_set_queue_coalesce(enable);
+	}
+
+	command_print(CMD, "jtag queue coalescing is %s",
+		jtag_get_queue_coalesce() ? "on" : "off");
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_wait_srst_deassert)
 {
 	if (CMD_ARGC != 1)
@@ -1273,6 +1290,15 @@ static const struct command_registration jtag_command_handlers[] = {
 			"to test performance or change in behavior. Default 0ms.",
 		.usage = "[sleep in ms]",
 	},
+	{
+		.name = "jtag_queue_coalesce",
+		.handler = handle_jtag_queue_coalesce,
+		.mode = COMMAND_ANY,
+		.help = "Merge adjacent JTAG commands (continued scans, "
+			"runtests, pathmoves) before executing the queue. "
+			"Default on.",
+		.usage = "['on'|'off']",
+	},
 	{
 		.name = "jtag_rclk",
 		.handler = handle_jtag_rclk_command,
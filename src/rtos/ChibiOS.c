@@ -107,6 +107,8 @@ static int ChibiOS_create(struct target *target);
 static int ChibiOS_update_threads(struct rtos *rtos);
 static int ChibiOS_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 		struct rtos_reg **reg_list, int *num_regs);
+static int ChibiOS_get_thread_stack(struct rtos *rtos, int64_t thread_id,
+		int64_t *stack_ptr, const struct rtos_register_stacking **stacking);
 static int ChibiOS_get_symbol_list_to_lookup(symbol_table_elem_t *symbol_list[]);
 
 struct rtos_type ChibiOS_rtos = {
@@ -116,6 +118,7 @@ struct rtos_type ChibiOS_rtos = {
 	.create = ChibiOS_create,
 	.update_threads = ChibiOS_update_threads,
 	.get_thread_reg_list = ChibiOS_get_thread_reg_list,
+	.get_thread_stack = ChibiOS_get_thread_stack,
 	.get_symbol_list_to_lookup = ChibiOS_get_symbol_list_to_lookup,
 };
 
@@ -489,16 +492,41 @@ static int ChibiOS_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 	}
 
 	/* Read the stack pointer */
-	retval = target_read_u32(rtos->target,
-							 thread_id + param->signature->cf_off_ctx, &stack_ptr);
+	uint8_t buf[4];
+	retval = rtos_read_buffer(rtos->target,
+							 thread_id + param->signature->cf_off_ctx, sizeof(buf), buf);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("Error reading stack frame from ChibiOS thread");
 		return retval;
 	}
+	stack_ptr = target_buffer_get_u32(rtos->target, buf);
 
 	return rtos_generic_stack_read(rtos->target, param->stacking_info, stack_ptr, reg_list, num_regs);
 }
 
+static int ChibiOS_get_thread_stack(struct rtos *rtos, int64_t thread_id,
+		int64_t *stack_ptr, const struct rtos_register_stacking **stacking)
+{
+	const struct ChibiOS_params *param = rtos->rtos_specific_params;
+	uint8_t buf[4];
+
+	/* The "Current Execution" placeholder is no thread. */
+	if (!param || !param->signature || thread_id <= 1)
+		return ERROR_FAIL;
+
+	if (!param->stacking_info && ChibiOS_update_stacking(rtos) != ERROR_OK)
+		return ERROR_FAIL;
+
+	int retval = rtos_read_buffer(rtos->target,
+			thread_id + param->signature->cf_off_ctx, sizeof(buf), buf);
+	if (retval != ERROR_OK)
+		return retval;
+
+	*stack_ptr = target_buffer_get_u32(rtos->target, buf);
+	*stacking = param->stacking_info;
+	return ERROR_OK;
+}
+
 static int ChibiOS_get_symbol_list_to_lookup(symbol_table_elem_t *symbol_list[])
 {
 	*symbol_list = malloc(sizeof(ChibiOS_symbol_list));
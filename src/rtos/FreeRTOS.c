@@ -43,6 +43,7 @@ struct FreeRTOS_params {
 	const unsigned char pointer_width;
 	const unsigned char list_next_offset;
 	const unsigned char list_width;
+	const unsigned char list_end_next_offset;
 	const unsigned char list_elem_next_offset;
 	const unsigned char list_elem_content_offset;
 	const unsigned char thread_stack_offset;
@@ -59,6 +60,7 @@ static const struct FreeRTOS_params FreeRTOS_params_list[] = {
 	4,						/* pointer_width; */
 	16,						/* list_next_offset; */
 	20,						/* list_width; */
+	12,						/* list_end_next_offset; */
 	8,						/* list_elem_next_offset; */
 	12,						/* list_elem_content_offset */
 	0,						/* thread_stack_offset; */
@@ -73,6 +75,7 @@ static const struct FreeRTOS_params FreeRTOS_params_list[] = {
 	4,						/* pointer_width; */
 	16,						/* list_next_offset; */
 	20,						/* list_width; */
+	12,						/* list_end_next_offset; */
 	8,						/* list_elem_next_offset; */
 	12,						/* list_elem_content_offset */
 	0,						/* thread_stack_offset; */
@@ -87,6 +90,7 @@ static const struct FreeRTOS_params FreeRTOS_params_list[] = {
 	4,						/* pointer_width; */
 	16,						/* list_next_offset; */
 	20,						/* list_width; */
+	12,						/* list_end_next_offset; */
 	8,						/* list_elem_next_offset; */
 	12,						/* list_elem_content_offset */
 	0,						/* thread_stack_offset; */
@@ -104,6 +108,8 @@ static int FreeRTOS_create(struct target *target);
 static int FreeRTOS_update_threads(struct rtos *rtos);
 static int FreeRTOS_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 		struct rtos_reg **reg_list, int *num_regs);
+static int FreeRTOS_get_thread_stack(struct rtos *rtos, int64_t thread_id,
+		int64_t *stack_ptr, const struct rtos_register_stacking **stacking);
 static int FreeRTOS_get_symbol_list_to_lookup(symbol_table_elem_t *symbol_list[]);
 
 struct rtos_type FreeRTOS_rtos = {
@@ -113,6 +119,7 @@ struct rtos_type FreeRTOS_rtos = {
 	.create = FreeRTOS_create,
 	.update_threads = FreeRTOS_update_threads,
 	.get_thread_reg_list = FreeRTOS_get_thread_reg_list,
+	.get_thread_stack = FreeRTOS_get_thread_stack,
 	.get_symbol_list_to_lookup = FreeRTOS_get_symbol_list_to_lookup,
 };
 
@@ -128,6 +135,7 @@ enum FreeRTOS_symbol_values {
 	FreeRTOS_VAL_xSuspendedTaskList = 8,
 	FreeRTOS_VAL_uxCurrentNumberOfTasks = 9,
 	FreeRTOS_VAL_uxTopUsedPriority = 10,
+	FreeRTOS_VAL_uxTaskNumber = 11,
 };
 
 struct symbols {
@@ -147,20 +155,52 @@ static const struct symbols FreeRTOS_symbol_list[] = {
 	{ "xSuspendedTaskList", true }, /* Only if INCLUDE_vTaskSuspend */
 	{ "uxCurrentNumberOfTasks", false },
 	{ "uxTopUsedPriority", true }, /* Unavailable since v7.5.3 */
+	{ "uxTaskNumber", true },
 	{ NULL, false }
 };
 
+/* Kernel objects less than this many bytes apart are read in one transfer.
+ * The list heads and counters are neighbours in tasks.c, so this usually
+ * fetches all of them at once. */
+#define FREERTOS_SNAPSHOT_GAP	256
+/* TCBs come from the same heap, so read the memory between the ones known
+ * from the list heads in one go if they are no further apart than this. */
+#define FREERTOS_SNAPSHOT_TCB_SPAN	(16 * 1024)
+/* Part of the name read along with a TCB; configMAX_TASK_NAME_LEN defaults
+ * to 16.  Longer names are read separately. */
+#define FREERTOS_SNAPSHOT_NAME_LEN	16
+
+#define FREERTOS_THREAD_NAME_STR_SIZE (200)
+
 /* TODO: */
 /* this is not safe for little endian yet */
 /* may be problems reading if sizes are not 32 bit long integers. */
 /* test mallocs for failure */
 
+/* Only the running task has extra info. */
+static void FreeRTOS_update_running(struct rtos *rtos)
+{
+	for (int i = 0; i < rtos->thread_count; i++) {
+		struct thread_detail *detail = &rtos->thread_details[i];
+		bool running = detail->threadid == rtos->current_thread;
+
+		if (running && !detail->extra_info_str) {
+			detail->extra_info_str = strdup("State: Running");
+		} else if (!running && detail->extra_info_str) {
+			free(detail->extra_info_str);
+			detail->extra_info_str = NULL;
+		}
+	}
+}
+
 static int FreeRTOS_update_threads(struct rtos *rtos)
 {
 	int i = 0;
 	int retval;
 	int tasks_found = 0;
 	const struct FreeRTOS_params *param;
+	struct rtos_snapshot *snap = &rtos->snapshot;
+	symbol_address_t *list_of_lists = NULL;
 
 	if (rtos->rtos_specific_params == NULL)
 		return -1;
@@ -177,8 +217,43 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 		return -2;
 	}
 
+	/* Instead of reading every counter, list head, list item and name on its
+	 * own, read the kernel data into a snapshot with a few large transfers
+	 * and walk the lists on the host.  Only list items outside the snapshot
+	 * still cost a round trip each. */
+	const uint32_t tcb_size = param->thread_name_offset + FREERTOS_SNAPSHOT_NAME_LEN;
+	unsigned int transfers = snap->transfers;
+	unsigned int hits = snap->hits;
+	unsigned int misses = snap->misses;
+	/* The counters and the heads of all lists walked below */
+	static const int list_heads[] = {
+		FreeRTOS_VAL_pxReadyTasksLists,
+		FreeRTOS_VAL_xDelayedTaskList1,
+		FreeRTOS_VAL_xDelayedTaskList2,
+		FreeRTOS_VAL_xPendingReadyList,
+		FreeRTOS_VAL_xSuspendedTaskList,
+		FreeRTOS_VAL_xTasksWaitingTermination,
+	};
+	retval = rtos_snapshot_add(snap, rtos->symbols[FreeRTOS_VAL_uxCurrentNumberOfTasks].address,
+			param->thread_count_width);
+	if (retval == ERROR_OK)
+		retval = rtos_snapshot_add(snap, rtos->symbols[FreeRTOS_VAL_pxCurrentTCB].address,
+				param->pointer_width);
+	if (retval == ERROR_OK)
+		retval = rtos_snapshot_add(snap, rtos->symbols[FreeRTOS_VAL_uxTopUsedPriority].address,
+				param->pointer_width);
+	if (retval == ERROR_OK)
+		retval = rtos_snapshot_add(snap, rtos->symbols[FreeRTOS_VAL_uxTaskNumber].address,
+				param->pointer_width);
+	for (unsigned int j = 0; retval == ERROR_OK && j < ARRAY_SIZE(list_heads); j++)
+		retval = rtos_snapshot_add(snap, rtos->symbols[list_heads[j]].address,
+				param->list_width);
+	if (retval != ERROR_OK)
+		goto done;
+	rtos_snapshot_fetch(snap, FREERTOS_SNAPSHOT_GAP);
+
 	int thread_list_size = 0;
-	retval = target_read_buffer(rtos->target,
+	retval = rtos_snapshot_read(snap,
 			rtos->symbols[FreeRTOS_VAL_uxCurrentNumberOfTasks].address,
 			param->thread_count_width,
 			(uint8_t *)&thread_list_size);
@@ -188,24 +263,41 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 
 	if (retval != ERROR_OK) {
 		LOG_ERROR("Could not read FreeRTOS thread count from target");
-		return retval;
+		goto done;
 	}
 
-	/* wipe out previous thread details if any */
-	rtos_free_threadlist(rtos);
-
 	/* read the current thread */
-	retval = target_read_buffer(rtos->target,
+	threadid_t current_thread = 0;
+	retval = rtos_snapshot_read(snap,
 			rtos->symbols[FreeRTOS_VAL_pxCurrentTCB].address,
 			param->pointer_width,
-			(uint8_t *)&rtos->current_thread);
+			(uint8_t *)&current_thread);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("Error reading current thread in FreeRTOS thread list");
-		return retval;
+		goto done;
 	}
 	LOG_DEBUG("FreeRTOS: Read pxCurrentTCB at 0x%" PRIx64 ", value 0x%" PRIx64 "\r\n",
 										rtos->symbols[FreeRTOS_VAL_pxCurrentTCB].address,
-										rtos->current_thread);
+										current_thread);
+
+	/* uxTaskNumber counts every task ever created, so as long as it and the
+	 * number of tasks stay the same, so do the TCBs and their names. */
+	uint64_t fingerprint[3] = { thread_list_size, 0, current_thread == 0 };
+	bool have_fingerprint = rtos->symbols[FreeRTOS_VAL_uxTaskNumber].address != 0 &&
+		rtos_snapshot_read(snap, rtos->symbols[FreeRTOS_VAL_uxTaskNumber].address,
+				param->pointer_width, (uint8_t *)&fingerprint[1]) == ERROR_OK;
+	if (have_fingerprint && rtos_thread_list_unchanged(rtos,
+				(const uint8_t *)fingerprint, sizeof(fingerprint))) {
+		rtos->current_thread = current_thread;
+		FreeRTOS_update_running(rtos);
+		LOG_DEBUG("FreeRTOS: task list unchanged");
+		retval = ERROR_OK;
+		goto done;
+	}
+
+	/* wipe out previous thread details if any */
+	rtos_free_threadlist(rtos);
+	rtos->current_thread = current_thread;
 
 	if ((thread_list_size  == 0) || (rtos->current_thread == 0)) {
 		/* Either : No RTOS threads - there is always at least the current execution though */
@@ -218,7 +310,8 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 				sizeof(struct thread_detail) * thread_list_size);
 		if (!rtos->thread_details) {
 			LOG_ERROR("Error allocating memory for %d threads", thread_list_size);
-			return ERROR_FAIL;
+			retval = ERROR_FAIL;
+			goto done;
 		}
 		rtos->thread_details->threadid = 1;
 		rtos->thread_details->exists = true;
@@ -228,7 +321,8 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 
 		if (thread_list_size == 1) {
 			rtos->thread_count = 1;
-			return ERROR_OK;
+			retval = ERROR_OK;
+			goto finished;
 		}
 	} else {
 		/* create space for new thread details */
@@ -236,37 +330,41 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 				sizeof(struct thread_detail) * thread_list_size);
 		if (!rtos->thread_details) {
 			LOG_ERROR("Error allocating memory for %d threads", thread_list_size);
-			return ERROR_FAIL;
+			retval = ERROR_FAIL;
+			goto done;
 		}
 	}
 
 	/* Find out how many lists are needed to be read from pxReadyTasksLists, */
 	if (rtos->symbols[FreeRTOS_VAL_uxTopUsedPriority].address == 0) {
 		LOG_ERROR("FreeRTOS: uxTopUsedPriority is not defined, consult the OpenOCD manual for a work-around");
-		return ERROR_FAIL;
+		retval = ERROR_FAIL;
+		goto done;
 	}
 	int64_t max_used_priority = 0;
-	retval = target_read_buffer(rtos->target,
+	retval = rtos_snapshot_read(snap,
 			rtos->symbols[FreeRTOS_VAL_uxTopUsedPriority].address,
 			param->pointer_width,
 			(uint8_t *)&max_used_priority);
 	if (retval != ERROR_OK)
-		return retval;
+		goto done;
 	LOG_DEBUG("FreeRTOS: Read uxTopUsedPriority at 0x%" PRIx64 ", value %" PRId64 "\r\n",
 										rtos->symbols[FreeRTOS_VAL_uxTopUsedPriority].address,
 										max_used_priority);
 	if (max_used_priority > FREERTOS_MAX_PRIORITIES) {
 		LOG_ERROR("FreeRTOS maximum used priority is unreasonably big, not proceeding: %" PRId64 "",
 			max_used_priority);
-		return ERROR_FAIL;
+		retval = ERROR_FAIL;
+		goto done;
 	}
 
-	symbol_address_t *list_of_lists =
+	list_of_lists =
 		malloc(sizeof(symbol_address_t) *
 			(max_used_priority + 5));
 	if (!list_of_lists) {
 		LOG_ERROR("Error allocating memory for %" PRId64 " priorities", max_used_priority);
-		return ERROR_FAIL;
+		retval = ERROR_FAIL;
+		goto done;
 	}
 
 	int num_lists;
@@ -280,20 +378,73 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 	list_of_lists[num_lists++] = rtos->symbols[FreeRTOS_VAL_xSuspendedTaskList].address;
 	list_of_lists[num_lists++] = rtos->symbols[FreeRTOS_VAL_xTasksWaitingTermination].address;
 
+	/* The whole array of ready lists is one object. */
+	if (max_used_priority > 1) {
+		retval = rtos_snapshot_add(snap, rtos->symbols[FreeRTOS_VAL_pxReadyTasksLists].address,
+				max_used_priority * param->list_width);
+		if (retval != ERROR_OK)
+			goto done;
+		rtos_snapshot_fetch(snap, 0);
+	}
+
+	/* Read the TCBs the list heads and pxCurrentTCB point at, together with
+	 * the heap between them if that is small enough. */
+	uint64_t tcb_low = UINT64_MAX;
+	uint64_t tcb_high = 0;
+	if (rtos->current_thread != 0) {
+		retval = rtos_snapshot_add(snap, rtos->current_thread, tcb_size);
+		if (retval != ERROR_OK)
+			goto done;
+		tcb_low = rtos->current_thread;
+		tcb_high = rtos->current_thread + tcb_size;
+	}
+	for (i = 0; i < num_lists; i++) {
+		int64_t list_thread_count = 0;
+		uint64_t list_elem_ptr = 0;
+
+		if (list_of_lists[i] == 0)
+			continue;
+		if (rtos_snapshot_read(snap, list_of_lists[i], param->thread_count_width,
+					(uint8_t *)&list_thread_count) != ERROR_OK ||
+				list_thread_count == 0)
+			continue;
+
+		/* Both ends of the list */
+		const unsigned char offsets[] = { param->list_next_offset, param->list_end_next_offset };
+		for (unsigned int j = 0; j < ARRAY_SIZE(offsets); j++) {
+			list_elem_ptr = 0;
+			if (rtos_snapshot_read(snap, list_of_lists[i] + offsets[j],
+						param->pointer_width, (uint8_t *)&list_elem_ptr) != ERROR_OK ||
+					list_elem_ptr == 0)
+				continue;
+
+			retval = rtos_snapshot_add(snap, list_elem_ptr, tcb_size);
+			if (retval != ERROR_OK)
+				goto done;
+			tcb_low = MIN(tcb_low, list_elem_ptr);
+			tcb_high = MAX(tcb_high, list_elem_ptr + tcb_size);
+		}
+	}
+	if (tcb_high > tcb_low && tcb_high - tcb_low <= FREERTOS_SNAPSHOT_TCB_SPAN) {
+		retval = rtos_snapshot_add(snap, tcb_low, tcb_high - tcb_low);
+		if (retval != ERROR_OK)
+			goto done;
+	}
+	rtos_snapshot_fetch(snap, FREERTOS_SNAPSHOT_GAP);
+
 	for (i = 0; i < num_lists; i++) {
 		if (list_of_lists[i] == 0)
 			continue;
 
 		/* Read the number of threads in this list */
 		int64_t list_thread_count = 0;
-		retval = target_read_buffer(rtos->target,
+		retval = rtos_snapshot_read(snap,
 				list_of_lists[i],
 				param->thread_count_width,
 				(uint8_t *)&list_thread_count);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("Error reading number of threads in FreeRTOS thread list");
-			free(list_of_lists);
-			return retval;
+			goto done;
 		}
 		LOG_DEBUG("FreeRTOS: Read thread count for list %d at 0x%" PRIx64 ", value %" PRId64 "\r\n",
 										i, list_of_lists[i], list_thread_count);
@@ -304,14 +455,13 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 		/* Read the location of first list item */
 		uint64_t prev_list_elem_ptr = -1;
 		uint64_t list_elem_ptr = 0;
-		retval = target_read_buffer(rtos->target,
+		retval = rtos_snapshot_read(snap,
 				list_of_lists[i] + param->list_next_offset,
 				param->pointer_width,
 				(uint8_t *)&list_elem_ptr);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
-			free(list_of_lists);
-			return retval;
+			goto done;
 		}
 		LOG_DEBUG("FreeRTOS: Read first item for list %d at 0x%" PRIx64 ", value 0x%" PRIx64 "\r\n",
 										i, list_of_lists[i] + param->list_next_offset, list_elem_ptr);
@@ -319,37 +469,39 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 		while ((list_thread_count > 0) && (list_elem_ptr != 0) &&
 				(list_elem_ptr != prev_list_elem_ptr) &&
 				(tasks_found < thread_list_size)) {
+			/* A list item outside the snapshot: fetch it together with the
+			 * rest of its TCB, with one transfer instead of three. */
+			if (!rtos_snapshot_covers(snap, list_elem_ptr, tcb_size)) {
+				rtos_snapshot_add(snap, list_elem_ptr, tcb_size);
+				rtos_snapshot_fetch(snap, 0);
+			}
+
 			/* Get the location of the thread structure. */
 			rtos->thread_details[tasks_found].threadid = 0;
-			retval = target_read_buffer(rtos->target,
+			retval = rtos_snapshot_read(snap,
 					list_elem_ptr + param->list_elem_content_offset,
 					param->pointer_width,
 					(uint8_t *)&(rtos->thread_details[tasks_found].threadid));
 			if (retval != ERROR_OK) {
 				LOG_ERROR("Error reading thread list item object in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
+				goto done;
 			}
 			LOG_DEBUG("FreeRTOS: Read Thread ID at 0x%" PRIx64 ", value 0x%" PRIx64 "\r\n",
 										list_elem_ptr + param->list_elem_content_offset,
 										rtos->thread_details[tasks_found].threadid);
 
 			/* get thread name */
-
-			#define FREERTOS_THREAD_NAME_STR_SIZE (200)
 			char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
 
 			/* Read the thread name */
-			retval = target_read_buffer(rtos->target,
+			retval = rtos_snapshot_read_string(snap,
 					rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
 					FREERTOS_THREAD_NAME_STR_SIZE,
-					(uint8_t *)&tmp_str);
+					tmp_str);
 			if (retval != ERROR_OK) {
 				LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
+				goto done;
 			}
-			tmp_str[FREERTOS_THREAD_NAME_STR_SIZE-1] = '\x00';
 			LOG_DEBUG("FreeRTOS: Read Thread Name at 0x%" PRIx64 ", value \"%s\"\r\n",
 										rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
 										tmp_str);
@@ -376,14 +528,13 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 
 			prev_list_elem_ptr = list_elem_ptr;
 			list_elem_ptr = 0;
-			retval = target_read_buffer(rtos->target,
+			retval = rtos_snapshot_read(snap,
 					prev_list_elem_ptr + param->list_elem_next_offset,
 					param->pointer_width,
 					(uint8_t *)&list_elem_ptr);
 			if (retval != ERROR_OK) {
 				LOG_ERROR("Error reading next thread item location in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
+				goto done;
 			}
 			LOG_DEBUG("FreeRTOS: Read next thread location at 0x%" PRIx64 ", value 0x%" PRIx64 "\r\n",
 										prev_list_elem_ptr + param->list_elem_next_offset,
@@ -391,9 +542,55 @@ static int FreeRTOS_update_threads(struct rtos *rtos)
 		}
 	}
 
-	free(list_of_lists);
 	rtos->thread_count = tasks_found;
-	return 0;
+	retval = ERROR_OK;
+
+finished:
+	rtos_thread_list_updated(rtos, (const uint8_t *)fingerprint,
+			have_fingerprint ? sizeof(fingerprint) : 0);
+done:
+	LOG_DEBUG("FreeRTOS: %d threads, %u transfers, %u reads from the snapshot, %u outside it",
+			tasks_found, snap->transfers - transfers, snap->hits - hits,
+			snap->misses - misses);
+	free(list_of_lists);
+	return retval;
+}
+
+/* Check for armv7m which includes a FPU */
+static bool FreeRTOS_has_fpu(struct rtos *rtos)
+{
+	struct armv7m_common *armv7m_target = target_to_armv7m(rtos->target);
+
+	return is_armv7m(armv7m_target) && armv7m_target->fp_feature == FPv4_SP;
+}
+
+/* Check for armv7m with *enabled* FPU, i.e. a Cortex-M4F.  CPACR is kept in
+ * the snapshot, so it is read once per halt rather than once per task. */
+static int FreeRTOS_fpu_enabled(struct rtos *rtos, bool *enabled)
+{
+	uint8_t cpacr[4];
+
+	*enabled = false;
+	if (!FreeRTOS_has_fpu(rtos))
+		return ERROR_OK;
+
+	if (!rtos_snapshot_covers(&rtos->snapshot, FPU_CPACR, sizeof(cpacr)) &&
+			rtos_snapshot_add(&rtos->snapshot, FPU_CPACR, sizeof(cpacr)) == ERROR_OK)
+		rtos_snapshot_fetch(&rtos->snapshot, 0);
+
+	int retval = rtos_read_buffer(rtos->target, FPU_CPACR, sizeof(cpacr), cpacr);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Could not read CPACR register to check FPU state");
+		return retval;
+	}
+
+	/* Check if CP10 and CP11 are set to full access. */
+	if (target_buffer_get_u32(rtos->target, cpacr) & 0x00F00000) {
+		/* Found target with enabled FPU */
+		*enabled = true;
+	}
+
+	return ERROR_OK;
 }
 
 static int FreeRTOS_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
@@ -415,7 +612,7 @@ static int FreeRTOS_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 	param = (const struct FreeRTOS_params *) rtos->rtos_specific_params;
 
 	/* Read the stack pointer */
-	retval = target_read_buffer(rtos->target,
+	retval = rtos_read_buffer(rtos->target,
 			thread_id + param->thread_stack_offset,
 			param->pointer_width,
 			(uint8_t *)&stack_ptr);
@@ -427,32 +624,14 @@ static int FreeRTOS_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 										thread_id + param->thread_stack_offset,
 										stack_ptr);
 
-	/* Check for armv7m with *enabled* FPU, i.e. a Cortex-M4F */
-	int cm4_fpu_enabled = 0;
-	struct armv7m_common *armv7m_target = target_to_armv7m(rtos->target);
-	if (is_armv7m(armv7m_target)) {
-		if (armv7m_target->fp_feature == FPv4_SP) {
-			/* Found ARM v7m target which includes a FPU */
-			uint32_t cpacr;
-
-			retval = target_read_u32(rtos->target, FPU_CPACR, &cpacr);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Could not read CPACR register to check FPU state");
-				return -1;
-			}
-
-			/* Check if CP10 and CP11 are set to full access. */
-			if (cpacr & 0x00F00000) {
-				/* Found target with enabled FPU */
-				cm4_fpu_enabled = 1;
-			}
-		}
-	}
+	bool cm4_fpu_enabled;
+	if (FreeRTOS_fpu_enabled(rtos, &cm4_fpu_enabled) != ERROR_OK)
+		return -1;
 
-	if (cm4_fpu_enabled == 1) {
+	if (cm4_fpu_enabled) {
 		/* Read the LR to decide between stacking with or without FPU */
 		uint32_t LR_svc = 0;
-		retval = target_read_buffer(rtos->target,
+		retval = rtos_read_buffer(rtos->target,
 				stack_ptr + 0x20,
 				param->pointer_width,
 				(uint8_t *)&LR_svc);
@@ -468,6 +647,63 @@ static int FreeRTOS_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 		return rtos_generic_stack_read(rtos->target, param->stacking_info_cm3, stack_ptr, reg_list, num_regs);
 }
 
+/* Read the saved stack pointers of all tasks at once, together with the
+ * memory between the TCBs if that is small enough.  Heap allocated stacks
+ * usually sit right next to their TCBs, so the stacked registers often come
+ * along for free. */
+static void FreeRTOS_fetch_stack_ptrs(struct rtos *rtos)
+{
+	const struct FreeRTOS_params *param = rtos->rtos_specific_params;
+	uint64_t low = UINT64_MAX;
+	uint64_t high = 0;
+
+	for (int i = 0; i < rtos->thread_count; i++) {
+		uint64_t address = rtos->thread_details[i].threadid + param->thread_stack_offset;
+
+		if (rtos->thread_details[i].threadid <= 1)
+			continue;
+		if (rtos_snapshot_add(&rtos->snapshot, address, param->pointer_width) != ERROR_OK)
+			break;
+		low = MIN(low, address);
+		high = MAX(high, address + param->pointer_width);
+	}
+	if (high > low && high - low <= FREERTOS_SNAPSHOT_TCB_SPAN)
+		rtos_snapshot_add(&rtos->snapshot, low, high - low);
+	/* the stacking of every task depends on CPACR */
+	if (FreeRTOS_has_fpu(rtos))
+		rtos_snapshot_add(&rtos->snapshot, FPU_CPACR, 4);
+	rtos_snapshot_fetch(&rtos->snapshot, FREERTOS_SNAPSHOT_GAP);
+}
+
+static int FreeRTOS_get_thread_stack(struct rtos *rtos, int64_t thread_id,
+		int64_t *stack_ptr, const struct rtos_register_stacking **stacking)
+{
+	const struct FreeRTOS_params *param = rtos->rtos_specific_params;
+
+	/* The "Current Execution" placeholder is no task. */
+	if (!param || thread_id <= 1)
+		return ERROR_FAIL;
+
+	if (!rtos_snapshot_covers(&rtos->snapshot, thread_id + param->thread_stack_offset,
+				param->pointer_width))
+		FreeRTOS_fetch_stack_ptrs(rtos);
+
+	*stack_ptr = 0;
+	int retval = rtos_read_buffer(rtos->target, thread_id + param->thread_stack_offset,
+			param->pointer_width, (uint8_t *)stack_ptr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	bool fpu_enabled;
+	retval = FreeRTOS_fpu_enabled(rtos, &fpu_enabled);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* The largest frame a task may have stacked */
+	*stacking = fpu_enabled ? param->stacking_info_cm4f_fpu : param->stacking_info_cm3;
+	return ERROR_OK;
+}
+
 static int FreeRTOS_get_symbol_list_to_lookup(symbol_table_elem_t *symbol_list[])
 {
 	unsigned int i;
@@ -505,7 +741,6 @@ static int FreeRTOS_get_thread_ascii_info(struct rtos *rtos, threadid_t thread_i
 
 	param = (const struct FreeRTOS_params *) rtos->rtos_specific_params;
 
-#define FREERTOS_THREAD_NAME_STR_SIZE (200)
 	char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
 
 	/* Read the thread name */
@@ -39,6 +39,8 @@ static bool ThreadX_detect_rtos(struct target *target);
 static int ThreadX_create(struct target *target);
 static int ThreadX_update_threads(struct rtos *rtos);
 static int ThreadX_get_thread_reg_list(struct rtos *rtos, int64_t thread_id, struct rtos_reg **reg_list, int *num_regs);
+static int ThreadX_get_thread_stack(struct rtos *rtos, int64_t thread_id,
+		int64_t *stack_ptr, const struct rtos_register_stacking **stacking);
 static int ThreadX_get_symbol_list_to_lookup(symbol_table_elem_t *symbol_list[]);
 
 
@@ -201,6 +203,7 @@ const struct rtos_type ThreadX_rtos = {
 	.create = ThreadX_create,
 	.update_threads = ThreadX_update_threads,
 	.get_thread_reg_list = ThreadX_get_thread_reg_list,
+	.get_thread_stack = ThreadX_get_thread_stack,
 	.get_symbol_list_to_lookup = ThreadX_get_symbol_list_to_lookup,
 };
 
@@ -235,7 +238,7 @@ static const struct rtos_register_stacking *get_stacking_info_arm926ejs(const st
 	int	retval;
 	uint32_t flag;
 
-	retval = target_read_buffer(rtos->target,
+	retval = rtos_read_buffer(rtos->target,
 			stack_ptr,
 			sizeof(flag),
 			(uint8_t *)&flag);
@@ -452,7 +455,7 @@ static int ThreadX_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 
 	/* Read the stack pointer */
 	int64_t stack_ptr = 0;
-	retval = target_read_buffer(rtos->target,
+	retval = rtos_read_buffer(rtos->target,
 			thread_id + param->thread_stack_offset,
 			param->pointer_width,
 			(uint8_t *)&stack_ptr);
@@ -461,7 +464,7 @@ static int ThreadX_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 		return retval;
 	}
 
-	LOG_INFO("thread: 0x%" PRIx64 ", stack_ptr=0x%" PRIx64, (uint64_t)thread_id, (uint64_t)stack_ptr);
+	LOG_DEBUG("thread: 0x%" PRIx64 ", stack_ptr=0x%" PRIx64, (uint64_t)thread_id, (uint64_t)stack_ptr);
 
 	if (stack_ptr == 0) {
 		LOG_ERROR("null stack pointer in thread");
@@ -479,6 +482,32 @@ static int ThreadX_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 	return rtos_generic_stack_read(rtos->target, stacking_info, stack_ptr, reg_list, num_regs);
 }
 
+static int ThreadX_get_thread_stack(struct rtos *rtos, int64_t thread_id,
+		int64_t *stack_ptr, const struct rtos_register_stacking **stacking)
+{
+	const struct ThreadX_params *param = rtos->rtos_specific_params;
+
+	/* The "Current Execution" placeholder is no thread. */
+	if (!param || thread_id <= 1 || !is_thread_id_valid(rtos, thread_id))
+		return ERROR_FAIL;
+
+	*stack_ptr = 0;
+	int retval = rtos_read_buffer(rtos->target,
+			thread_id + param->thread_stack_offset,
+			param->pointer_width,
+			(uint8_t *)stack_ptr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* The largest frame a thread may have stacked */
+	*stacking = param->stacking_info;
+	for (size_t i = 1; i < param->stacking_info_nb; i++) {
+		if (param->stacking_info[i].stack_registers_size > (*stacking)->stack_registers_size)
+			*stacking = &param->stacking_info[i];
+	}
+	return ERROR_OK;
+}
+
 static int ThreadX_get_symbol_list_to_lookup(symbol_table_elem_t *symbol_list[])
 {
 	unsigned int i;
@@ -258,6 +258,7 @@ static int nuttx_update_threads(struct rtos *rtos)
 	uint32_t tcb_addr;
 	uint32_t i;
 	uint8_t state;
+	struct rtos_snapshot snap;
 
 	if (rtos->symbols == NULL) {
 		LOG_ERROR("No symbols for NuttX");
@@ -276,16 +277,24 @@ static int nuttx_update_threads(struct rtos *rtos)
 
 	thread_count = 0;
 
+	/* The queue heads are neighbours in the kernel's data, read them
+	 * together. */
+	rtos_snapshot_init(&snap, rtos->target);
+	for (i = 0; i < TASK_QUEUE_NUM; i++)
+		rtos_snapshot_add(&snap, g_tasklist[i].addr, sizeof(head));
+	rtos_snapshot_fetch(&snap, 64);
+
 	for (i = 0; i < TASK_QUEUE_NUM; i++) {
 
 		if (g_tasklist[i].addr == 0)
 			continue;
 
-		ret = target_read_u32(rtos->target, g_tasklist[i].addr,
-			&head);
+		ret = rtos_snapshot_read(&snap, g_tasklist[i].addr,
+			sizeof(head), (uint8_t *)&head);
 
 		if (ret) {
 			LOG_ERROR("target_read_u32 : ret = %d\n", ret);
+			rtos_snapshot_free(&snap);
 			return ERROR_FAIL;
 		}
 
@@ -302,6 +311,7 @@ static int nuttx_update_threads(struct rtos *rtos)
 			if (ret) {
 				LOG_ERROR("target_read_buffer : ret = %d\n",
 					ret);
+				rtos_snapshot_free(&snap);
 				return ERROR_FAIL;
 			}
 			thread_count++;
@@ -335,6 +345,7 @@ static int nuttx_update_threads(struct rtos *rtos)
 		}
 	}
 	rtos->thread_count = thread_count;
+	rtos_snapshot_free(&snap);
 
 	return 0;
 }
@@ -55,6 +55,9 @@ static struct rtos_type *rtos_types[] = {
 };
 
 int rtos_thread_packet(struct connection *connection, const char *packet, int packet_size);
+static int rtos_event_callback(struct target *target, enum target_event event, void *priv);
+
+static bool rtos_callbacks_registered;
 
 int rtos_smp_init(struct target *target)
 {
@@ -84,6 +87,12 @@ static int os_alloc(struct target *target, struct rtos_type *ostype)
 	os->current_thread = 0;
 	os->symbols = NULL;
 	os->target = target;
+	rtos_snapshot_init(&os->snapshot, target);
+
+	if (!rtos_callbacks_registered) {
+		target_register_event_callback(rtos_event_callback, NULL);
+		rtos_callbacks_registered = true;
+	}
 
 	/* RTOS drivers can override the packet handler in _create(). */
 	os->gdb_thread_packet = rtos_thread_packet;
@@ -100,6 +109,7 @@ static void os_free(struct target *target)
 	if (target->rtos->symbols)
 		free(target->rtos->symbols);
 
+	rtos_invalidate_thread_regs(target);
 	free(target->rtos);
 	target->rtos = NULL;
 }
@@ -361,6 +371,7 @@ int rtos_thread_packet(struct connection *connection, char const *packet, int pa
 				target->rtos_auto_detect = false;
 				target->rtos->type->create(target);
 			}
+			rtos_invalidate_thread_regs(target);
 			target->rtos->type->update_threads(target->rtos);
 		}
 		return ERROR_OK;
@@ -444,8 +455,7 @@ int rtos_thread_packet(struct connection *connection, char const *packet, int pa
 	return GDB_THREAD_PACKET_NOT_CONSUMED;
 }
 
-static int rtos_put_gdb_reg_list(struct connection *connection,
-		struct rtos_reg *reg_list, int num_regs)
+static char *rtos_format_gdb_reg_list(struct rtos_reg *reg_list, int num_regs)
 {
 	size_t num_bytes = 1; /* NUL */
 	for (int i = 0; i < num_regs; ++i)
@@ -453,6 +463,9 @@ static int rtos_put_gdb_reg_list(struct connection *connection,
 
 	char *hex = malloc(num_bytes);
 	char *hex_p = hex;
+	if (!hex)
+		return NULL;
+	*hex_p = '\0';
 
 	for (int i = 0; i < num_regs; ++i) {
 		size_t count = DIV_ROUND_UP(reg_list[i].size, 8);
@@ -461,12 +474,188 @@ static int rtos_put_gdb_reg_list(struct connection *connection,
 		num_bytes -= n;
 	}
 
+	return hex;
+}
+
+static int rtos_put_gdb_reg_list(struct connection *connection,
+		struct rtos_reg *reg_list, int num_regs)
+{
+	char *hex = rtos_format_gdb_reg_list(reg_list, num_regs);
+	if (!hex)
+		return ERROR_FAIL;
+
 	gdb_put_packet(connection, hex, strlen(hex));
 	free(hex);
 
 	return ERROR_OK;
 }
 
+static struct rtos_thread_regs *rtos_find_thread_regs(struct rtos *rtos, threadid_t threadid)
+{
+	for (int i = 0; i < rtos->num_thread_regs; i++) {
+		if (rtos->thread_regs[i].threadid == threadid)
+			return &rtos->thread_regs[i];
+	}
+	return NULL;
+}
+
+/* Takes over @a reg_list. */
+static struct rtos_thread_regs *rtos_cache_thread_regs(struct rtos *rtos, threadid_t threadid,
+		struct rtos_reg *reg_list, int num_regs)
+{
+	char *hex = rtos_format_gdb_reg_list(reg_list, num_regs);
+	struct rtos_thread_regs *thread_regs = realloc(rtos->thread_regs,
+			(rtos->num_thread_regs + 1) * sizeof(*thread_regs));
+	if (!hex || !thread_regs) {
+		free(hex);
+		free(reg_list);
+		return NULL;
+	}
+
+	rtos->thread_regs = thread_regs;
+	thread_regs = &rtos->thread_regs[rtos->num_thread_regs++];
+	thread_regs->threadid = threadid;
+	thread_regs->reg_list = reg_list;
+	thread_regs->num_regs = num_regs;
+	thread_regs->hex = hex;
+	return thread_regs;
+}
+
+/* Stacked registers less than this many bytes apart are read in one go. */
+#define RTOS_STACK_FRAME_GAP	256
+
+static bool rtos_thread_stack(struct rtos *rtos, threadid_t threadid,
+		target_addr_t *address, uint32_t *size)
+{
+	const struct rtos_register_stacking *stacking;
+	int64_t stack_ptr = 0;
+
+	if (rtos->type->get_thread_stack(rtos, threadid, &stack_ptr, &stacking) != ERROR_OK ||
+			stack_ptr == 0)
+		return false;
+
+	*address = stack_ptr;
+	*size = stacking->stack_registers_size;
+	if (stacking->stack_growth_direction == 1)
+		*address -= *size;
+	return true;
+}
+
+/**
+ * GDB usually asks for the registers of every thread in turn, e.g. for
+ * "thread apply all bt".  So the first time it asks for any, read the
+ * stacked registers of all threads into the snapshot, merging those that
+ * are close together, and decode and cache them all.
+ */
+static void rtos_prefetch_thread_regs(struct rtos *rtos)
+{
+	target_addr_t address;
+	uint32_t size;
+
+	rtos->thread_regs_prefetched = true;
+
+	unsigned int transfers = rtos->snapshot.transfers;
+	for (int i = 0; i < rtos->thread_count; i++) {
+		threadid_t threadid = rtos->thread_details[i].threadid;
+		/* The registers of the running thread are the CPU's. */
+		if (threadid == rtos->current_thread && !rtos->target->smp)
+			continue;
+		if (!rtos_find_thread_regs(rtos, threadid) &&
+				rtos_thread_stack(rtos, threadid, &address, &size))
+			rtos_snapshot_add(&rtos->snapshot, address, size);
+	}
+	rtos_snapshot_fetch(&rtos->snapshot, RTOS_STACK_FRAME_GAP);
+
+	int found = 0;
+	for (int i = 0; i < rtos->thread_count; i++) {
+		threadid_t threadid = rtos->thread_details[i].threadid;
+		struct rtos_reg *reg_list;
+		int num_regs;
+
+		/* Leave threads whose registers could not be read to the error
+		 * reporting of the usual path. */
+		if ((threadid == rtos->current_thread && !rtos->target->smp) ||
+				rtos_find_thread_regs(rtos, threadid) ||
+				!rtos_thread_stack(rtos, threadid, &address, &size) ||
+				!rtos_snapshot_covers(&rtos->snapshot, address, size))
+			continue;
+		if (rtos->type->get_thread_reg_list(rtos, threadid, &reg_list, &num_regs) != ERROR_OK)
+			continue;
+		if (rtos_cache_thread_regs(rtos, threadid, reg_list, num_regs))
+			found++;
+	}
+
+	LOG_DEBUG("RTOS: prefetched the registers of %d threads with %u transfers",
+			found, rtos->snapshot.transfers - transfers);
+}
+
+/**
+ * The registers of a thread whose driver allows caching them.  The result
+ * stays owned by the cache.
+ */
+static int rtos_get_thread_regs(struct rtos *rtos, threadid_t threadid,
+		struct rtos_thread_regs **regs)
+{
+	*regs = rtos_find_thread_regs(rtos, threadid);
+	if (!*regs && !rtos->thread_regs_prefetched) {
+		rtos_prefetch_thread_regs(rtos);
+		*regs = rtos_find_thread_regs(rtos, threadid);
+	}
+	if (*regs)
+		return ERROR_OK;
+
+	struct rtos_reg *reg_list;
+	int num_regs;
+	int retval = rtos->type->get_thread_reg_list(rtos, threadid, &reg_list, &num_regs);
+	if (retval != ERROR_OK)
+		return retval;
+
+	*regs = rtos_cache_thread_regs(rtos, threadid, reg_list, num_regs);
+	return *regs ? ERROR_OK : ERROR_FAIL;
+}
+
+/**
+ * Forget the cached thread registers and the memory snapshot.  Called
+ * whenever the target may have run or its memory was written.
+ */
+void rtos_invalidate_thread_regs(struct target *target)
+{
+	struct rtos *rtos = target->rtos;
+
+	if (!rtos)
+		return;
+
+	for (int i = 0; i < rtos->num_thread_regs; i++) {
+		free(rtos->thread_regs[i].reg_list);
+		free(rtos->thread_regs[i].hex);
+	}
+	free(rtos->thread_regs);
+	rtos->thread_regs = NULL;
+	rtos->num_thread_regs = 0;
+	rtos->thread_regs_prefetched = false;
+	rtos_snapshot_free(&rtos->snapshot);
+}
+
+static int rtos_event_callback(struct target *target, enum target_event event, void *priv)
+{
+	/* None of these let the target run. */
+	switch (event) {
+	case TARGET_EVENT_GDB_HALT:
+	case TARGET_EVENT_HALTED:
+	case TARGET_EVENT_DEBUG_HALTED:
+	case TARGET_EVENT_GDB_END:
+	case TARGET_EVENT_GDB_ATTACH:
+	case TARGET_EVENT_GDB_DETACH:
+	case TARGET_EVENT_TRACE_CONFIG:
+		break;
+	default:
+		rtos_invalidate_thread_regs(target);
+		break;
+	}
+
+	return ERROR_OK;
+}
+
 /** Look through all registers to find this register. */
 int rtos_get_gdb_reg(struct connection *connection, int reg_num)
 {
@@ -486,7 +675,20 @@ int rtos_get_gdb_reg(struct connection *connection, int reg_num)
 										target->rtos->current_thread);
 
 		int retval;
-		if (target->rtos->type->get_thread_reg) {
+		if (target->rtos->type->get_thread_stack) {
+			struct rtos_thread_regs *regs;
+			retval = rtos_get_thread_regs(target->rtos, current_threadid, &regs);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("RTOS: failed to get register list");
+				return retval;
+			}
+
+			for (int i = 0; i < regs->num_regs; ++i) {
+				if (regs->reg_list[i].number == (uint32_t)reg_num)
+					return rtos_put_gdb_reg_list(connection, regs->reg_list + i, 1);
+			}
+			return ERROR_FAIL;
+		} else if (target->rtos->type->get_thread_reg) {
 			reg_list = calloc(1, sizeof(*reg_list));
 			num_regs = 1;
 			retval = target->rtos->type->get_thread_reg(target->rtos,
@@ -536,6 +738,18 @@ int rtos_get_gdb_reg_list(struct connection *connection)
 										current_threadid,
 										target->rtos->current_thread);
 
+		if (target->rtos->type->get_thread_stack) {
+			struct rtos_thread_regs *regs;
+			int retval = rtos_get_thread_regs(target->rtos, current_threadid, &regs);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("RTOS: failed to get register list");
+				return retval;
+			}
+
+			gdb_put_packet(connection, regs->hex, strlen(regs->hex));
+			return ERROR_OK;
+		}
+
 		int retval = target->rtos->type->get_thread_reg_list(target->rtos,
 				current_threadid,
 				&reg_list,
@@ -562,6 +776,7 @@ int rtos_set_reg(struct connection *connection, int reg_num,
 			(target->rtos->type->set_reg != NULL) &&
 			(current_threadid != -1) &&
 			(current_threadid != 0)) {
+		rtos_invalidate_thread_regs(target);
 		return target->rtos->type->set_reg(target->rtos, reg_num, reg_value);
 	}
 	return ERROR_FAIL;
@@ -585,7 +800,7 @@ int rtos_generic_stack_read(struct target *target,
 
 	if (stacking->stack_growth_direction == 1)
 		address -= stacking->stack_registers_size;
-	retval = target_read_buffer(target, address, stacking->stack_registers_size, stack_data);
+	retval = rtos_read_buffer(target, address, stacking->stack_registers_size, stack_data);
 	if (retval != ERROR_OK) {
 		free(stack_data);
 		LOG_ERROR("Error reading stack frame from thread");
@@ -628,6 +843,204 @@ int rtos_generic_stack_read(struct target *target,
 	return ERROR_OK;
 }
 
+void rtos_snapshot_init(struct rtos_snapshot *snap, struct target *target)
+{
+	memset(snap, 0, sizeof(*snap));
+	snap->target = target;
+}
+
+void rtos_snapshot_free(struct rtos_snapshot *snap)
+{
+	for (unsigned int i = 0; i < snap->num_regions; i++)
+		free(snap->regions[i].data);
+	free(snap->regions);
+	snap->regions = NULL;
+	snap->num_regions = 0;
+	snap->num_fetched = 0;
+	snap->max_regions = 0;
+}
+
+/** Queue a region of target memory for the next rtos_snapshot_fetch(). */
+int rtos_snapshot_add(struct rtos_snapshot *snap, target_addr_t address, uint32_t size)
+{
+	if (address == 0 || size == 0)
+		return ERROR_OK;
+
+	if (snap->num_regions == snap->max_regions) {
+		unsigned int max_regions = snap->max_regions ? 2 * snap->max_regions : 16;
+		struct rtos_snapshot_region *regions = realloc(snap->regions,
+				max_regions * sizeof(*regions));
+		if (!regions) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		snap->regions = regions;
+		snap->max_regions = max_regions;
+	}
+
+	struct rtos_snapshot_region *region = &snap->regions[snap->num_regions++];
+	region->address = address;
+	region->size = size;
+	region->data = NULL;
+	return ERROR_OK;
+}
+
+static int rtos_snapshot_region_compare(const void *a, const void *b)
+{
+	const struct rtos_snapshot_region *ra = a, *rb = b;
+
+	if (ra->address != rb->address)
+		return ra->address < rb->address ? -1 : 1;
+	return 0;
+}
+
+static int rtos_snapshot_read_region(struct rtos_snapshot *snap,
+		struct rtos_snapshot_region *region)
+{
+	region->data = malloc(region->size);
+	if (!region->data) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	snap->transfers++;
+	int retval = target_read_buffer(snap->target, region->address, region->size,
+			region->data);
+	if (retval != ERROR_OK) {
+		free(region->data);
+		region->data = NULL;
+	}
+	return retval;
+}
+
+/**
+ * Read all queued regions.  Regions that overlap or are at most @a max_gap
+ * bytes apart are read in one transfer.  If such a combined read fails, the
+ * regions are read one by one, and those that still cannot be read are
+ * dropped: rtos_snapshot_read() then reports the error for them.
+ */
+int rtos_snapshot_fetch(struct rtos_snapshot *snap, uint32_t max_gap)
+{
+	struct rtos_snapshot_region *pending = snap->regions + snap->num_fetched;
+	unsigned int num_pending = snap->num_regions - snap->num_fetched;
+	unsigned int out = snap->num_fetched;
+
+	qsort(pending, num_pending, sizeof(*pending), rtos_snapshot_region_compare);
+
+	unsigned int i = 0;
+	while (i < num_pending) {
+		target_addr_t start = pending[i].address;
+		target_addr_t end = start + pending[i].size;
+		unsigned int j = i + 1;
+		while (j < num_pending && pending[j].address <= end + max_gap) {
+			end = MAX(end, pending[j].address + pending[j].size);
+			j++;
+		}
+
+		struct rtos_snapshot_region span = {
+			.address = start,
+			.size = end - start,
+		};
+		int retval = rtos_snapshot_read_region(snap, &span);
+		if (retval == ERROR_OK) {
+			snap->regions[out++] = span;
+		} else if (j - i > 1) {
+			LOG_DEBUG("RTOS: could not read 0x%" TARGET_PRIxADDR "..0x%" TARGET_PRIxADDR
+					", reading its parts", start, end);
+			/* Reading into the slot of an earlier region is safe: out never
+			 * passes the index of the region being read. */
+			for (; i < j; i++) {
+				struct rtos_snapshot_region part = pending[i];
+				if (rtos_snapshot_read_region(snap, &part) == ERROR_OK)
+					snap->regions[out++] = part;
+			}
+		}
+		i = j;
+	}
+
+	snap->num_regions = out;
+	snap->num_fetched = out;
+	return ERROR_OK;
+}
+
+static const uint8_t *rtos_snapshot_find(struct rtos_snapshot *snap,
+		target_addr_t address, uint32_t *available)
+{
+	for (unsigned int i = 0; i < snap->num_fetched; i++) {
+		struct rtos_snapshot_region *region = &snap->regions[i];
+		if (address >= region->address &&
+				address - region->address < region->size) {
+			target_addr_t offset = address - region->address;
+			*available = region->size - offset;
+			return region->data + offset;
+		}
+	}
+	return NULL;
+}
+
+bool rtos_snapshot_covers(struct rtos_snapshot *snap, target_addr_t address, uint32_t size)
+{
+	uint32_t available;
+	return rtos_snapshot_find(snap, address, &available) && available >= size;
+}
+
+/**
+ * Read target memory for the RTOS of @a target, from what is already known
+ * about the halted target where possible.
+ */
+int rtos_read_buffer(struct target *target, target_addr_t address,
+		uint32_t size, uint8_t *buffer)
+{
+	if (!target->rtos)
+		return target_read_buffer(target, address, size, buffer);
+	return rtos_snapshot_read(&target->rtos->snapshot, address, size, buffer);
+}
+
+/** Read target memory, from the snapshot if it holds the whole range. */
+int rtos_snapshot_read(struct rtos_snapshot *snap, target_addr_t address,
+		uint32_t size, uint8_t *buffer)
+{
+	uint32_t available;
+	const uint8_t *data = rtos_snapshot_find(snap, address, &available);
+
+	if (data && available >= size) {
+		snap->hits++;
+		memcpy(buffer, data, size);
+		return ERROR_OK;
+	}
+
+	snap->misses++;
+	return target_read_buffer(snap->target, address, size, buffer);
+}
+
+/**
+ * Read a NUL terminated string of at most @a size - 1 characters.  The
+ * snapshot is good enough as long as it holds the terminating NUL.
+ */
+int rtos_snapshot_read_string(struct rtos_snapshot *snap, target_addr_t address,
+		uint32_t size, char *buffer)
+{
+	uint32_t available;
+	const uint8_t *data = rtos_snapshot_find(snap, address, &available);
+
+	if (size == 0)
+		return ERROR_OK;
+
+	if (data) {
+		uint32_t len = MIN(available, size - 1);
+		if (memchr(data, 0, len)) {
+			snap->hits++;
+			strcpy(buffer, (const char *)data);
+			return ERROR_OK;
+		}
+	}
+
+	snap->misses++;
+	int retval = target_read_buffer(snap->target, address, size, (uint8_t *)buffer);
+	buffer[size - 1] = '\0';
+	return retval;
+}
+
 int rtos_try_next(struct target *target)
 {
 	struct rtos *os = target->rtos;
@@ -653,25 +1066,74 @@ int rtos_try_next(struct target *target)
 
 int rtos_update_threads(struct target *target)
 {
-	if ((target->rtos != NULL) && (target->rtos->type != NULL))
+	if ((target->rtos != NULL) && (target->rtos->type != NULL)) {
+		/* The target may have run since the last update. */
+		rtos_invalidate_thread_regs(target);
 		target->rtos->type->update_threads(target->rtos);
+	}
 	return ERROR_OK;
 }
 
+static void rtos_free_thread_details(struct thread_detail *details, int count)
+{
+	if (!details)
+		return;
+
+	for (int j = 0; j < count; j++) {
+		free(details[j].thread_name_str);
+		free(details[j].extra_info_str);
+	}
+	free(details);
+}
+
 void rtos_free_threadlist(struct rtos *rtos)
 {
-	if (rtos->thread_details) {
-		int j;
+	free(rtos->fingerprint);
+	rtos->fingerprint = NULL;
+	rtos->fingerprint_size = 0;
 
-		for (j = 0; j < rtos->thread_count; j++) {
-			struct thread_detail *current_thread = &rtos->thread_details[j];
-			free(current_thread->thread_name_str);
-			free(current_thread->extra_info_str);
-		}
-		free(rtos->thread_details);
+	if (rtos->thread_details) {
+		rtos_free_thread_details(rtos->thread_details, rtos->thread_count);
 		rtos->thread_details = NULL;
 		rtos->thread_count = 0;
 		rtos->current_threadid = -1;
 		rtos->current_thread = 0;
 	}
 }
+
+/**
+ * Drivers that can summarize everything their thread list is made from in a
+ * few bytes of kernel state (task counts, generation counters, list heads)
+ * call this before walking the threads.  When it returns true the list of
+ * the previous update is still valid and only the current thread needs to be
+ * refreshed.  The summary is recorded by rtos_thread_list_updated().
+ */
+bool rtos_thread_list_unchanged(struct rtos *rtos, const uint8_t *fingerprint, uint32_t size)
+{
+	if (!rtos->thread_details || !rtos->fingerprint ||
+			rtos->fingerprint_size != size ||
+			memcmp(rtos->fingerprint, fingerprint, size))
+		return false;
+
+	/* Same as after a rebuild of the list. */
+	rtos->current_threadid = -1;
+	return true;
+}
+
+/**
+ * Record the kernel state a freshly built thread list was made from, for
+ * rtos_thread_list_unchanged() to compare with on the next update.
+ */
+void rtos_thread_list_updated(struct rtos *rtos, const uint8_t *fingerprint, uint32_t size)
+{
+	free(rtos->fingerprint);
+	rtos->fingerprint = NULL;
+	rtos->fingerprint_size = 0;
+	if (fingerprint && size) {
+		rtos->fingerprint = malloc(size);
+		if (rtos->fingerprint) {
+			memcpy(rtos->fingerprint, fingerprint, size);
+			rtos->fingerprint_size = size;
+		}
+	}
+}
@@ -27,6 +27,7 @@ typedef int64_t threadid_t;
 typedef int64_t symbol_address_t;
 
 struct reg;
+struct rtos_register_stacking;
 
 /**
  * Table should be terminated by an element with NULL in symbol_name
@@ -44,6 +45,42 @@ struct thread_detail {
 	char *extra_info_str;
 };
 
+/**
+ * A host side copy of some regions of target memory.  RTOS drivers queue the
+ * kernel objects they are about to walk with rtos_snapshot_add(), read them
+ * with a few large transfers in rtos_snapshot_fetch() and then look at them
+ * with rtos_snapshot_read(), which only goes to the target for addresses that
+ * were not fetched.
+ */
+struct rtos_snapshot_region {
+	target_addr_t address;
+	uint32_t size;
+	/* NULL while the region is only queued */
+	uint8_t *data;
+};
+
+struct rtos_snapshot {
+	struct target *target;
+	struct rtos_snapshot_region *regions;
+	unsigned int num_regions;
+	unsigned int num_fetched;
+	unsigned int max_regions;
+	/* statistics */
+	unsigned int transfers;
+	unsigned int hits;
+	unsigned int misses;
+};
+
+/* Registers of a thread that are not the CPU's, cached until the target
+ * resumes. */
+struct rtos_thread_regs {
+	threadid_t threadid;
+	struct rtos_reg *reg_list;
+	int num_regs;
+	/* the same, formatted for the GDB 'g' packet */
+	char *hex;
+};
+
 struct rtos {
 	const struct rtos_type *type;
 
@@ -56,6 +93,16 @@ struct rtos {
 	threadid_t current_thread;
 	struct thread_detail *thread_details;
 	int thread_count;
+	/* The kernel state thread_details was made from, see
+	 * rtos_thread_list_unchanged(). */
+	uint8_t *fingerprint;
+	uint32_t fingerprint_size;
+	/* Target memory read while the target is halted, see rtos_read_buffer(). */
+	struct rtos_snapshot snapshot;
+	/* Cached thread registers, see rtos_invalidate_thread_regs(). */
+	struct rtos_thread_regs *thread_regs;
+	int num_thread_regs;
+	bool thread_regs_prefetched;
 	int (*gdb_thread_packet)(struct connection *connection, char const *packet, int packet_size);
 	int (*gdb_target_for_threadid)(struct connection *connection, int64_t thread_id, struct target **p_target);
 	void *rtos_specific_params;
@@ -82,6 +129,12 @@ struct rtos_type {
 	int (*clean)(struct target *target);
 	char * (*ps_command)(struct target *target);
 	int (*set_reg)(struct rtos *rtos, uint32_t reg_num, uint8_t *reg_value);
+	/** Optional: the saved stack pointer of a thread and the largest
+	 * stacking its registers may use.  Drivers providing this must read
+	 * everything through rtos_read_buffer(), so the stacked registers of all
+	 * threads can be read in one pass and cached until the target resumes. */
+	int (*get_thread_stack)(struct rtos *rtos, int64_t thread_id,
+			int64_t *stack_ptr, const struct rtos_register_stacking **stacking);
 };
 
 struct stack_register_offset {
@@ -120,11 +173,25 @@ int rtos_generic_stack_read(struct target *target,
 		struct rtos_reg **reg_list,
 		int *num_regs);
 int rtos_try_next(struct target *target);
+void rtos_snapshot_init(struct rtos_snapshot *snap, struct target *target);
+void rtos_snapshot_free(struct rtos_snapshot *snap);
+int rtos_snapshot_add(struct rtos_snapshot *snap, target_addr_t address, uint32_t size);
+int rtos_snapshot_fetch(struct rtos_snapshot *snap, uint32_t max_gap);
+bool rtos_snapshot_covers(struct rtos_snapshot *snap, target_addr_t address, uint32_t size);
+int rtos_snapshot_read(struct rtos_snapshot *snap, target_addr_t address,
+		uint32_t size, uint8_t *buffer);
+int rtos_snapshot_read_string(struct rtos_snapshot *snap, target_addr_t address,
+		uint32_t size, char *buffer);
+int rtos_read_buffer(struct target *target, target_addr_t address,
+		uint32_t size, uint8_t *buffer);
+void rtos_invalidate_thread_regs(struct target *target);
 int gdb_thread_packet(struct connection *connection, char const *packet, int packet_size);
 int rtos_get_gdb_reg(struct connection *connection, int reg_num);
 int rtos_get_gdb_reg_list(struct connection *connection);
 int rtos_update_threads(struct target *target);
 void rtos_free_threadlist(struct rtos *rtos);
+bool rtos_thread_list_unchanged(struct rtos *rtos, const uint8_t *fingerprint, uint32_t size);
+void rtos_thread_list_updated(struct rtos *rtos, const uint8_t *fingerprint, uint32_t size);
 int rtos_smp_init(struct target *target);
 /*  function for handling symbol access */
 int rtos_qsymbol(struct connection *connection, char const *packet, int packet_size);
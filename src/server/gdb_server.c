@@ -44,6 +44,7 @@
 #include <target/target.h>
 #include <target/target_type.h>
 #include <target/semihosting_common.h>
+#include <target/mem_cache.h>
 #include "server.h"
 #include <flash/nor/core.h>
 #include "gdb_server.h"
@@ -67,8 +68,17 @@ struct target_desc_format {
 };
 
 /* private connection data for GDB */
+/* Large memory reads are streamed to GDB in chunks of this size, see
+ * gdb_read_memory_packet(). */
+#define GDB_MEM_CHUNK_SIZE 4096
+
 struct gdb_connection {
 	char buffer[GDB_BUFFER_SIZE + 1]; /* Extra byte for nul-termination */
+	/* reusable buffers for streaming memory reads; the hex reply is kept
+	 * whole so that a retransmission sends the same bytes again */
+	uint8_t mem_chunk[GDB_MEM_CHUNK_SIZE];
+	char *mem_hex;
+	size_t mem_hex_size;
 	char *buf_p;
 	int buf_cnt;
 	int ctrl_c;
@@ -357,6 +367,63 @@ static int gdb_write(struct connection *connection, void *data, int len)
 	return ERROR_SERVER_REMOTE_CLOSED;
 }
 
+/* Wait for GDB to acknowledge the packet that was just sent.  Sets
+ * @a resend if GDB asked for a retransmission. */
+static int gdb_get_packet_ack(struct connection *connection, bool *resend)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	int reply;
+	int retval;
+
+	*resend = false;
+
+	if (gdb_con->noack_mode)
+		return ERROR_OK;
+
+	retval = gdb_get_char(connection, &reply);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (reply == '+')
+		return ERROR_OK;
+	else if (reply == '-') {
+		/* Stop sending output packets for now */
+		log_remove_callback(gdb_log_callback, connection);
+		LOG_WARNING("negative reply, retrying");
+		*resend = true;
+	} else if (reply == 0x3) {
+		gdb_con->ctrl_c = 1;
+		retval = gdb_get_char(connection, &reply);
+		if (retval != ERROR_OK)
+			return retval;
+		if (reply == '+')
+			return ERROR_OK;
+		else if (reply == '-') {
+			/* Stop sending output packets for now */
+			log_remove_callback(gdb_log_callback, connection);
+			LOG_WARNING("negative reply, retrying");
+			*resend = true;
+		} else if (reply == '$') {
+			LOG_ERROR("GDB missing ack(1) - assumed good");
+			gdb_putback_char(connection, reply);
+		} else {
+			LOG_ERROR("unknown character(1) 0x%2.2x in reply, dropping connection", reply);
+			gdb_con->closed = true;
+			return ERROR_SERVER_REMOTE_CLOSED;
+		}
+	} else if (reply == '$') {
+		LOG_ERROR("GDB missing ack(2) - assumed good");
+		gdb_putback_char(connection, reply);
+	} else {
+		LOG_ERROR("unknown character(2) 0x%2.2x in reply, dropping connection",
+			reply);
+		gdb_con->closed = true;
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
+	return ERROR_OK;
+}
+
 static int gdb_put_packet_inner(struct connection *connection,
 		char *buffer, int len)
 {
@@ -364,8 +431,9 @@ static int gdb_put_packet_inner(struct connection *connection,
 	unsigned char my_checksum = 0;
 #ifdef _DEBUG_GDB_IO_
 	char *debug_buffer;
-#endif
 	int reply;
+#endif
+	bool resend;
 	int retval;
 	struct gdb_connection *gdb_con = connection->priv;
 
@@ -430,50 +498,12 @@ static int gdb_put_packet_inner(struct connection *connection,
 				return retval;
 		}
 
-		if (gdb_con->noack_mode)
-			break;
-
-		retval = gdb_get_char(connection, &reply);
-		if (retval != ERROR_OK)
-			return retval;
-
-		if (reply == '+')
+		retval = gdb_get_packet_ack(connection, &resend);
+		if (retval != ERROR_OK || !resend)
 			break;
-		else if (reply == '-') {
-			/* Stop sending output packets for now */
-			log_remove_callback(gdb_log_callback, connection);
-			LOG_WARNING("negative reply, retrying");
-		} else if (reply == 0x3) {
-			gdb_con->ctrl_c = 1;
-			retval = gdb_get_char(connection, &reply);
-			if (retval != ERROR_OK)
-				return retval;
-			if (reply == '+')
-				break;
-			else if (reply == '-') {
-				/* Stop sending output packets for now */
-				log_remove_callback(gdb_log_callback, connection);
-				LOG_WARNING("negative reply, retrying");
-			} else if (reply == '$') {
-				LOG_ERROR("GDB missing ack(1) - assumed good");
-				gdb_putback_char(connection, reply);
-				return ERROR_OK;
-			} else {
-				LOG_ERROR("unknown character(1) 0x%2.2x in reply, dropping connection", reply);
-				gdb_con->closed = true;
-				return ERROR_SERVER_REMOTE_CLOSED;
-			}
-		} else if (reply == '$') {
-			LOG_ERROR("GDB missing ack(2) - assumed good");
-			gdb_putback_char(connection, reply);
-			return ERROR_OK;
-		} else {
-			LOG_ERROR("unknown character(2) 0x%2.2x in reply, dropping connection",
-				reply);
-			gdb_con->closed = true;
-			return ERROR_SERVER_REMOTE_CLOSED;
-		}
 	}
+	if (retval != ERROR_OK)
+		return retval;
 	if (gdb_con->closed)
 		return ERROR_SERVER_REMOTE_CLOSED;
 
@@ -955,6 +985,8 @@ static int gdb_new_connection(struct connection *connection)
 	gdb_connection->target_desc.tdesc = NULL;
 	gdb_connection->target_desc.tdesc_length = 0;
 	gdb_connection->thread_list = NULL;
+	gdb_connection->mem_hex = NULL;
+	gdb_connection->mem_hex_size = 0;
 
 	/* send ACK to GDB for debug request */
 	gdb_write(connection, "+", 1);
@@ -1058,6 +1090,7 @@ static int gdb_connection_closed(struct connection *connection)
 	delete_debug_msg_receiver(connection->cmd_ctx, target);
 
 	if (connection->priv) {
+		free(gdb_connection->mem_hex);
 		free(connection->priv);
 		connection->priv = NULL;
 	} else
@@ -1268,6 +1301,7 @@ static int gdb_set_registers_packet(struct connection *connection,
 		gdb_target_to_reg(target, packet_p, chars, bin_buf);
 
 		retval = reg_list[i]->type->set(reg_list[i], bin_buf);
+		mem_cache_invalidate(target);
 		if (retval != ERROR_OK && gdb_report_register_access_error) {
 			LOG_DEBUG("Couldn't set register %s.", reg_list[i]->name);
 			free(reg_list);
@@ -1391,6 +1425,7 @@ static int gdb_set_register_packet(struct connection *connection,
 	gdb_target_to_reg(target, separator + 1, chars, bin_buf);
 
 	retval = reg_list[reg_num]->type->set(reg_list[reg_num], bin_buf);
+	mem_cache_invalidate(target);
 	if (retval != ERROR_OK && gdb_report_register_access_error) {
 		LOG_DEBUG("Couldn't set register %s.", reg_list[reg_num]->name);
 		free(bin_buf);
@@ -1420,6 +1455,119 @@ static int gdb_error(struct connection *connection, int retval)
 /* We don't have to worry about the default 2 second timeout for GDB packets,
  * because GDB breaks up large memory reads into smaller reads.
  */
+/* Read one chunk of a streamed memory read into gdb_con->mem_chunk. */
+static int gdb_read_memory_chunk(struct target *target, struct gdb_connection *gdb_con,
+		uint64_t addr, uint32_t len)
+{
+	int retval = target_read_buffer_cached(target, addr, len, gdb_con->mem_chunk);
+
+	if ((retval != ERROR_OK) && !gdb_report_data_abort) {
+		/* TODO : Here we have to lie and send back all zero's lest stack traces won't work.
+		 * At some point this might be fixed in GDB, in which case this code can be removed.
+		 *
+		 * OpenOCD developers are acutely aware of this problem, but there is nothing
+		 * gained by involving the user in this problem that hopefully will get resolved
+		 * eventually
+		 *
+		 * http://sourceware.org/cgi-bin/gnatsweb.pl? \
+		 * cmd = view%20audit-trail&database = gdb&pr = 2395
+		 *
+		 * For now, the default is to fix up things to make current GDB versions work.
+		 * This can be overwritten using the gdb_report_data_abort <'enable'|'disable'> command.
+		 */
+		memset(gdb_con->mem_chunk, 0, len);
+		retval = ERROR_OK;
+	}
+
+	return retval;
+}
+
+/* Reply to a memory read while it is being read.  The target is read
+ * GDB_MEM_CHUNK_SIZE bytes at a time and each chunk is hex encoded into
+ * gdb_con->mem_hex and written out while the checksum is accumulated, so
+ * the socket drains while the next chunk is read.
+ *
+ * With gdb_report_data_abort enabled any chunk may fail, and that has to
+ * become an error reply, so then the whole range is read before the
+ * packet is started.  A retransmission request sends the same hex again
+ * rather than reading the target a second time, which could give
+ * different data for peripheral registers. */
+static int gdb_stream_memory_packet(struct connection *connection,
+		struct target *target, uint64_t addr, uint32_t len)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	bool stream = !gdb_report_data_abort;
+	unsigned char my_checksum = 0;
+	char trailer[4];
+	bool resend;
+	int retval;
+
+	size_t hex_size = 2 * (size_t)len + 1;
+	if (gdb_con->mem_hex_size < hex_size) {
+		char *hex = realloc(gdb_con->mem_hex, hex_size);
+		if (!hex) {
+			LOG_ERROR("not enough memory for a %" PRIu32 " byte read", len);
+			return gdb_error(connection, ERROR_FAIL);
+		}
+		gdb_con->mem_hex = hex;
+		gdb_con->mem_hex_size = hex_size;
+	}
+
+	if (stream) {
+		retval = gdb_write(connection, "$", 1);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	for (uint32_t offset = 0; offset < len; ) {
+		uint32_t chunk = MIN(len - offset, GDB_MEM_CHUNK_SIZE);
+		retval = gdb_read_memory_chunk(target, gdb_con, addr + offset, chunk);
+		if (retval != ERROR_OK)
+			return gdb_error(connection, retval);
+
+		char *hex = gdb_con->mem_hex + 2 * offset;
+		size_t hex_len = hexify(hex, gdb_con->mem_chunk, chunk,
+				gdb_con->mem_hex_size - 2 * offset);
+		for (size_t i = 0; i < hex_len; i++)
+			my_checksum += hex[i];
+
+		if (stream) {
+			retval = gdb_write(connection, hex, hex_len);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		offset += chunk;
+	}
+
+	snprintf(trailer, sizeof(trailer), "#%02x", my_checksum);
+
+	/* when streaming, "$" and the data are out already */
+	bool sent = stream;
+	do {
+		if (!sent) {
+			retval = gdb_write(connection, "$", 1);
+			if (retval == ERROR_OK)
+				retval = gdb_write(connection, gdb_con->mem_hex, 2 * len);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		sent = false;
+
+		retval = gdb_write(connection, trailer, 3);
+		if (retval != ERROR_OK)
+			return retval;
+
+		retval = gdb_get_packet_ack(connection, &resend);
+		if (retval != ERROR_OK)
+			return retval;
+	} while (resend);
+
+	if (gdb_con->closed)
+		return ERROR_SERVER_REMOTE_CLOSED;
+
+	return ERROR_OK;
+}
+
 static int gdb_read_memory_packet(struct connection *connection,
 		char const *packet, int packet_size)
 {
@@ -1428,9 +1576,6 @@ static int gdb_read_memory_packet(struct connection *connection,
 	uint64_t addr = 0;
 	uint32_t len = 0;
 
-	uint8_t *buffer;
-	char *hex_buffer;
-
 	int retval = ERROR_OK;
 
 	/* skip command character */
@@ -1451,42 +1596,15 @@ static int gdb_read_memory_packet(struct connection *connection,
 		return ERROR_OK;
 	}
 
-	buffer = malloc(len);
-
 	LOG_DEBUG("addr: 0x%16.16" PRIx64 ", len: 0x%8.8" PRIx32 "", addr, len);
 
-	retval = target_read_buffer(target, addr, len, buffer);
-
-	if ((retval != ERROR_OK) && !gdb_report_data_abort) {
-		/* TODO : Here we have to lie and send back all zero's lest stack traces won't work.
-		 * At some point this might be fixed in GDB, in which case this code can be removed.
-		 *
-		 * OpenOCD developers are acutely aware of this problem, but there is nothing
-		 * gained by involving the user in this problem that hopefully will get resolved
-		 * eventually
-		 *
-		 * http://sourceware.org/cgi-bin/gnatsweb.pl? \
-		 * cmd = view%20audit-trail&database = gdb&pr = 2395
-		 *
-		 * For now, the default is to fix up things to make current GDB versions work.
-		 * This can be overwritten using the gdb_report_data_abort <'enable'|'disable'> command.
-		 */
-		memset(buffer, 0, len);
-		retval = ERROR_OK;
-	}
-
-	if (retval == ERROR_OK) {
-		hex_buffer = malloc(len * 2 + 1);
-
-		size_t pkt_len = hexify(hex_buffer, buffer, len, len * 2 + 1);
-
-		gdb_put_packet(connection, hex_buffer, pkt_len);
-
-		free(hex_buffer);
-	} else
-		retval = gdb_error(connection, retval);
+	struct gdb_connection *gdb_con = connection->priv;
+	gdb_con->busy = true;
+	retval = gdb_stream_memory_packet(connection, target, addr, len);
+	gdb_con->busy = false;
 
-	free(buffer);
+	/* we sent some data, reset timer for keep alive messages */
+	kept_alive();
 
 	return retval;
 }
@@ -33,6 +33,7 @@
 #include "openocd.h"
 #include "tcl_server.h"
 #include "telnet_server.h"
+#include <helper/time_support.h>
 
 #include <signal.h>
 
@@ -44,6 +45,12 @@
 #include <netinet/tcp.h>
 #endif
 
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_TIMERFD_H)
+#define USE_EPOLL 1
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#endif
+
 static struct service *services;
 
 enum shutdown_reason {
@@ -63,6 +70,81 @@ static int polling_period = 100;
 /* address by name on which to listen for incoming TCP/IP connections */
 static char *bindto_name;
 
+#ifdef USE_EPOLL
+/* Registrations are kept persistent instead of rebuilding an fd_set on
+ * every iteration.  Connection fds and the timer live in epoll_fd.
+ * Listening fds live in listen_epoll_fd, which is itself registered in
+ * epoll_fd, so the event data pointer alone tells the two apart. */
+static int epoll_fd = -1;
+static int listen_epoll_fd = -1;
+static int timer_fd = -1;
+/* What timer_fd is armed for, so it is only set again when that changes */
+static bool timer_armed;
+static struct timeval timer_armed_when;
+
+/* Set when a registration went away while dispatching a batch of
+ * events; the rest of the batch may point to freed memory.  Epoll is
+ * level triggered, so unhandled events are simply reported again. */
+static bool epoll_stale;
+
+static void server_epoll_quit(void);
+
+static void server_watch(int epfd, int fd, void *ptr)
+{
+	if (epfd == -1 || fd == -1)
+		return;
+
+	struct epoll_event ev = { .events = EPOLLIN, .data.ptr = ptr };
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+		/* e.g. stdin redirected from a regular file */
+		LOG_DEBUG("epoll_ctl(%d): %s, falling back to select()", fd, strerror(errno));
+		server_epoll_quit();
+	}
+}
+
+static void server_unwatch(int epfd, int fd)
+{
+	if (epfd == -1 || fd == -1)
+		return;
+
+	epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+	epoll_stale = true;
+}
+
+static void server_epoll_init(void)
+{
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	listen_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (epoll_fd == -1 || listen_epoll_fd == -1 || timer_fd == -1) {
+		LOG_DEBUG("epoll unavailable, using select()");
+		server_epoll_quit();
+		return;
+	}
+	server_watch(epoll_fd, listen_epoll_fd, &listen_epoll_fd);
+	server_watch(epoll_fd, timer_fd, &timer_fd);
+}
+
+static void server_epoll_quit(void)
+{
+	if (epoll_fd != -1)
+		close(epoll_fd);
+	if (listen_epoll_fd != -1)
+		close(listen_epoll_fd);
+	if (timer_fd != -1)
+		close(timer_fd);
+	epoll_fd = listen_epoll_fd = timer_fd = -1;
+	timer_armed = false;
+	/* the rest of a batch being dispatched is no longer valid */
+	epoll_stale = true;
+}
+#else
+static inline void server_watch(int epfd, int fd, void *ptr) {}
+static inline void server_unwatch(int epfd, int fd) {}
+#define listen_epoll_fd (-1)
+#define epoll_fd (-1)
+#endif
+
 static int add_connection(struct service *service, struct command_context *cmd_ctx)
 {
 	socklen_t address_size;
@@ -116,6 +198,7 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 #endif
 
 		/* do not check for new connections again on stdin */
+		server_unwatch(listen_epoll_fd, service->fd);
 		service->fd = -1;
 
 		LOG_INFO("accepting '%s' connection from pipe", service->name);
@@ -129,6 +212,7 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 	} else if (service->type == CONNECTION_PIPE) {
 		c->fd = service->fd;
 		/* do not check for new connections again on stdin */
+		server_unwatch(listen_epoll_fd, service->fd);
 		service->fd = -1;
 
 		char *out_file = alloc_printf("%so", service->port);
@@ -156,6 +240,8 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 		;
 	*p = c;
 
+	server_watch(epoll_fd, c->fd, c);
+
 	if (service->max_connections != CONNECTION_LIMIT_UNLIMITED)
 		service->max_connections--;
 
@@ -171,11 +257,13 @@ static int remove_connection(struct service *service, struct connection *connect
 	while ((c = *p)) {
 		if (c->fd == connection->fd) {
 			service->connection_closed(c);
+			server_unwatch(epoll_fd, c->fd);
 			if (service->type == CONNECTION_TCP)
 				close_socket(c->fd);
 			else if (service->type == CONNECTION_PIPE) {
 				/* The service will listen to the pipe again */
 				c->service->fd = c->fd;
+				server_watch(listen_epoll_fd, c->fd, c->service);
 			}
 
 			command_done(c->cmd_ctx);
@@ -346,6 +434,8 @@ int add_service(char *name,
 		;
 	*p = c;
 
+	server_watch(listen_epoll_fd, c->fd, c);
+
 	return ERROR_OK;
 }
 
@@ -380,6 +470,8 @@ int remove_service(const char *name, const char *port)
 			else
 				prev->next = tmp->next;
 
+			server_unwatch(listen_epoll_fd, tmp->fd);
+
 			if (tmp->type != CONNECTION_STDINOUT)
 				close_socket(tmp->fd);
 
@@ -402,6 +494,7 @@ static int remove_services(void)
 		struct service *next = c->next;
 
 		remove_connections(c);
+		server_unwatch(listen_epoll_fd, c->fd);
 
 		if (c->name)
 			free(c->name);
@@ -428,6 +521,151 @@ static int remove_services(void)
 	return ERROR_OK;
 }
 
+static void server_accept(struct service *service, struct command_context *cmd_ctx)
+{
+	if (service->max_connections != 0)
+		add_connection(service, cmd_ctx);
+	else {
+		if (service->type == CONNECTION_TCP) {
+			struct sockaddr_in sin;
+			socklen_t address_size = sizeof(sin);
+			int tmp_fd;
+			tmp_fd = accept(service->fd,
+					(struct sockaddr *)&service->sin,
+					&address_size);
+			close_socket(tmp_fd);
+		}
+		LOG_INFO(
+			"rejected '%s' connection, no more connections allowed",
+			service->name);
+	}
+}
+
+/* Returns false if the connection was dropped. */
+static bool server_input(struct service *service, struct connection *c)
+{
+	int retval = service->input(c);
+	if (retval != ERROR_OK) {
+		if (service->type == CONNECTION_PIPE ||
+				service->type == CONNECTION_STDINOUT) {
+			/* if connection uses a pipe then
+			 * shutdown openocd on error */
+			shutdown_openocd = SHUTDOWN_REQUESTED;
+		}
+		remove_connection(service, c);
+		LOG_INFO("dropped '%s' connection",
+			service->name);
+		return false;
+	}
+	return true;
+}
+
+#ifdef USE_EPOLL
+static void server_timer_arm(void)
+{
+	struct itimerspec its = { .it_value = { .tv_sec = 0, .tv_nsec = 0 } };
+	struct timeval when = { 0, 0 }, now;
+	bool pending = target_timer_next_event(&when) == ERROR_OK;
+
+	/* still armed for the same event */
+	if (pending == timer_armed &&
+			(!pending || timeval_compare(&when, &timer_armed_when) == 0))
+		return;
+
+	if (pending) {
+		gettimeofday(&now, NULL);
+		if (timeval_compare(&when, &now) > 0) {
+			struct timeval delta;
+			timeval_subtract(&delta, &when, &now);
+			its.it_value.tv_sec = delta.tv_sec;
+			its.it_value.tv_nsec = delta.tv_usec * 1000L;
+		} else {
+			/* already due; a zero value would disarm the timer */
+			its.it_value.tv_nsec = 1;
+		}
+	}
+
+	timerfd_settime(timer_fd, 0, &its, NULL);
+	timer_armed = pending;
+	timer_armed_when = when;
+}
+
+/* One iteration of server_loop() using the persistent epoll
+ * registrations.  Timer callbacks are driven by timer_fd, so they
+ * fire when due instead of at the next polling_period boundary. */
+static int server_epoll_iteration(struct command_context *command_context, bool *poll_ok)
+{
+	struct epoll_event events[16];
+	int n;
+
+	server_timer_arm();
+
+	if (*poll_ok) {
+		/* we're just polling this iteration, this is faster on embedded
+		 * hosts */
+		n = epoll_wait(epoll_fd, events, ARRAY_SIZE(events), 0);
+	} else {
+		/* Every 100ms, can be changed with "poll_period" command */
+		openocd_sleep_prelude();
+		kept_alive();
+		n = epoll_wait(epoll_fd, events, ARRAY_SIZE(events), polling_period);
+		openocd_sleep_postlude();
+	}
+
+	if (n == -1 && errno != EINTR) {
+		LOG_ERROR("error during epoll_wait: %s", strerror(errno));
+		return ERROR_FAIL;
+	}
+
+	if (n == 0) {
+		/* We only execute these callbacks when there was nothing to do or we timed
+		 *out */
+		target_call_timer_callbacks();
+		process_jim_events(command_context);
+		*poll_ok = false;
+	} else
+		*poll_ok = true;
+
+	*poll_ok = *poll_ok || target_got_message();
+
+	epoll_stale = false;
+	for (int i = 0; i < n && !epoll_stale; i++) {
+		void *ptr = events[i].data.ptr;
+
+		if (ptr == &timer_fd) {
+			uint64_t expirations;
+			if (read(timer_fd, &expirations, sizeof(expirations)) < 0)
+				LOG_DEBUG("timerfd read: %s", strerror(errno));
+			/* one shot; if it fired a little early the callback
+			 * is still due and needs the timer again */
+			timer_armed = false;
+			target_call_timer_callbacks();
+		} else if (ptr == &listen_epoll_fd) {
+			struct epoll_event ready[8];
+			int m = epoll_wait(listen_epoll_fd, ready, ARRAY_SIZE(ready), 0);
+			for (int j = 0; j < m && !epoll_stale; j++)
+				server_accept(ready[j].data.ptr, command_context);
+		} else {
+			struct connection *c = ptr;
+			server_input(c->service, c);
+		}
+	}
+
+	/* Connections with data buffered in user space don't show up as
+	 * readable on the fd. */
+	for (struct service *service = services; service; service = service->next) {
+		for (struct connection *c = service->connections; c; ) {
+			struct connection *next = c->next;
+			if (c->input_pending)
+				server_input(service, c);
+			c = next;
+		}
+	}
+
+	return ERROR_OK;
+}
+#endif
+
 int server_loop(struct command_context *command_context)
 {
 	struct service *service;
@@ -447,6 +685,15 @@ int server_loop(struct command_context *command_context)
 #endif
 
 	while (shutdown_openocd == CONTINUE_MAIN_LOOP) {
+#ifdef USE_EPOLL
+		if (epoll_fd != -1) {
+			retval = server_epoll_iteration(command_context, &poll_ok);
+			if (retval != ERROR_OK)
+				return retval;
+			continue;
+		}
+#endif
+
 		/* monitor sockets for activity */
 		fd_max = 0;
 		FD_ZERO(&read_fds);
@@ -538,48 +785,18 @@ int server_loop(struct command_context *command_context)
 		for (service = services; service; service = service->next) {
 			/* handle new connections on listeners */
 			if ((service->fd != -1)
-				&& (FD_ISSET(service->fd, &read_fds))) {
-				if (service->max_connections != 0)
-					add_connection(service, command_context);
-				else {
-					if (service->type == CONNECTION_TCP) {
-						struct sockaddr_in sin;
-						socklen_t address_size = sizeof(sin);
-						int tmp_fd;
-						tmp_fd = accept(service->fd,
-								(struct sockaddr *)&service->sin,
-								&address_size);
-						close_socket(tmp_fd);
-					}
-					LOG_INFO(
-						"rejected '%s' connection, no more connections allowed",
-						service->name);
-				}
-			}
+				&& (FD_ISSET(service->fd, &read_fds)))
+				server_accept(service, command_context);
 
 			/* handle activity on connections */
 			if (service->connections) {
 				struct connection *c;
 
 				for (c = service->connections; c; ) {
-					if ((c->fd >= 0 && FD_ISSET(c->fd, &read_fds)) || c->input_pending) {
-						retval = service->input(c);
-						if (retval != ERROR_OK) {
-							struct connection *next = c->next;
-							if (service->type == CONNECTION_PIPE ||
-									service->type == CONNECTION_STDINOUT) {
-								/* if connection uses a pipe then
-								 * shutdown openocd on error */
-								shutdown_openocd = SHUTDOWN_REQUESTED;
-							}
-							remove_connection(service, c);
-							LOG_INFO("dropped '%s' connection",
-								service->name);
-							c = next;
-							continue;
-						}
-					}
-					c = c->next;
+					struct connection *next = c->next;
+					if ((c->fd >= 0 && FD_ISSET(c->fd, &read_fds)) || c->input_pending)
+						server_input(service, c);
+					c = next;
 				}
 			}
 		}
@@ -662,6 +879,10 @@ int server_preinit(void)
 	signal(SIGTERM, sig_handler);
 	signal(SIGABRT, sig_handler);
 
+#ifdef USE_EPOLL
+	server_epoll_init();
+#endif
+
 	return ERROR_OK;
 }
 
@@ -687,6 +908,10 @@ int server_quit(void)
 	remove_services();
 	target_quit();
 
+#ifdef USE_EPOLL
+	server_epoll_quit();
+#endif
+
 #ifdef _WIN32
 	WSACleanup();
 	SetConsoleCtrlHandler(ControlHandler, FALSE);
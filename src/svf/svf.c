@@ -33,6 +33,11 @@
 #include "svf.h"
 #include <helper/time_support.h>
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 /* SVF command */
 enum svf_command {
 	ENDDR,
@@ -206,23 +211,30 @@ struct svf_check_tdo_para {
 	int bit_len;		/* bit length to check */
 };
 
-#define SVF_CHECK_TDO_PARA_SIZE 1024
+#define SVF_CHECK_TDO_PARA_SIZE 4096
 static struct svf_check_tdo_para *svf_check_tdo_para;
 static int svf_check_tdo_para_index;
 
-static int svf_read_command_from_file(FILE *fd);
+static int svf_read_command(void);
 static int svf_check_tdo(void);
 static int svf_add_check_para(uint8_t enabled, int buffer_offset, int bit_len);
 static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str);
 static int svf_execute_tap(void);
 
-static FILE *svf_fd;
-static char *svf_read_line;
-static size_t svf_read_line_size;
+/* The whole SVF file, mapped if possible, otherwise read into memory */
+static const char *svf_data;
+static size_t svf_data_size;
+static size_t svf_data_pos;
+static bool svf_data_mapped;
+/* Text of the current command echoed to the log, not NUL terminated */
+static const char *svf_read_line;
+static int svf_read_line_len;
 static char *svf_command_buffer;
 static size_t svf_command_buffer_size;
 static int svf_line_number;
-static int svf_getline(char **lineptr, size_t *n, FILE *stream);
+
+/* Time spent in each phase of the svf command, in seconds */
+static float svf_load_time, svf_parse_time, svf_execute_time;
 
 #define SVF_MAX_BUFFER_SIZE_TO_COMMIT   (1024 * 1024)
 static uint8_t *svf_tdi_buffer, *svf_tdo_buffer, *svf_mask_buffer;
@@ -256,6 +268,10 @@ static void svf_hexbuf_print(int dbg_lvl, const char *file, unsigned line,
 	int byte_len = DIV_ROUND_UP(bit_len, 8);
 	int msbits = bit_len % 8;
 
+	/* don't format scans nobody will see */
+	if (dbg_lvl > debug_level)
+		return;
+
 	/* allocate 2 bytes per hex digit */
 	char *prbuf = malloc((byte_len * 2) + 2 + 1);
 	if (!prbuf)
@@ -272,6 +288,95 @@ static void svf_hexbuf_print(int dbg_lvl, const char *file, unsigned line,
 	free(prbuf);
 }
 
+static void svf_close_file(void)
+{
+	if (!svf_data)
+		return;
+
+#ifdef HAVE_SYS_MMAN_H
+	if (svf_data_mapped)
+		munmap((void *)svf_data, svf_data_size);
+	else
+#endif
+		free((void *)svf_data);
+
+	svf_data = NULL;
+	svf_data_size = 0;
+	svf_data_pos = 0;
+	svf_data_mapped = false;
+}
+
+/* Makes the whole file available in svf_data. Regular files are mapped,
+ * anything else (or a host without mmap) is read into memory. On failure
+ * errno tells why. */
+static int svf_open_file(const char *path)
+{
+	struct duration load;
+	FILE *fp;
+	char *data = NULL;
+	size_t size = 0, allocated = 0;
+
+	svf_close_file();
+	duration_start(&load);
+
+	fp = fopen(path, "rb");
+	if (!fp)
+		return ERROR_FAIL;
+
+#ifdef HAVE_SYS_MMAN_H
+	struct stat st;
+	if (fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0
+			&& (uintmax_t)st.st_size <= SIZE_MAX) {
+		void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+		if (map != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+			madvise(map, st.st_size, MADV_SEQUENTIAL);
+#endif
+			fclose(fp);
+			svf_data = map;
+			svf_data_size = st.st_size;
+			svf_data_mapped = true;
+			if (duration_measure(&load) == ERROR_OK)
+				svf_load_time = duration_elapsed(&load);
+			return ERROR_OK;
+		}
+	}
+#endif
+
+	for (;;) {
+		if (size == allocated) {
+			allocated = allocated ? 2 * allocated : 64 * 1024;
+			char *ptr = realloc(data, allocated);
+			if (!ptr) {
+				free(data);
+				fclose(fp);
+				errno = ENOMEM;
+				return ERROR_FAIL;
+			}
+			data = ptr;
+		}
+		size_t n = fread(data + size, 1, allocated - size, fp);
+		if (n == 0)
+			break;
+		size += n;
+	}
+
+	if (ferror(fp)) {
+		int err = errno;
+		free(data);
+		fclose(fp);
+		errno = err;
+		return ERROR_FAIL;
+	}
+	fclose(fp);
+
+	svf_data = data;
+	svf_data_size = size;
+	if (duration_measure(&load) == ERROR_OK)
+		svf_load_time = duration_elapsed(&load);
+	return ERROR_OK;
+}
+
 static int svf_realloc_buffers(size_t len)
 {
 	void *ptr;
@@ -398,8 +503,7 @@ COMMAND_HANDLER(handle_svf_command)
 				  "ignore_error") == 0) || (strcmp(CMD_ARGV[i], "-ignore_error") == 0))
 			svf_ignore_error = 1;
 		else {
-			svf_fd = fopen(CMD_ARGV[i], "r");
-			if (svf_fd == NULL) {
+			if (svf_open_file(CMD_ARGV[i]) != ERROR_OK) {
 				int err = errno;
 				command_print(CMD, "open(\"%s\"): %s", CMD_ARGV[i], strerror(err));
 				/* no need to free anything now */
@@ -409,15 +513,17 @@ COMMAND_HANDLER(handle_svf_command)
 		}
 	}
 
-	if (svf_fd == NULL)
+	if (svf_data == NULL)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
 	/* get time */
 	time_measure_ms = timeval_ms();
 
 	/* init */
-	svf_line_number = 0;
+	svf_line_number = 1;
 	svf_command_buffer_size = 0;
+	svf_parse_time = 0;
+	svf_execute_time = 0;
 
 	svf_check_tdo_para_index = 0;
 	svf_check_tdo_para = malloc(sizeof(struct svf_check_tdo_para) * SVF_CHECK_TDO_PARA_SIZE);
@@ -490,13 +596,17 @@ COMMAND_HANDLER(handle_svf_command)
 
 	if (svf_progress_enabled) {
 		/* Count total lines in file. */
-		while (!feof(svf_fd)) {
-			svf_getline(&svf_command_buffer, &svf_command_buffer_size, svf_fd);
+		const char *p = svf_data, *end = svf_data + svf_data_size;
+		svf_total_lines = 1;
+		while ((p = memchr(p, '\n', end - p))) {
+			p++;
 			svf_total_lines++;
 		}
-		rewind(svf_fd);
 	}
-	while (ERROR_OK == svf_read_command_from_file(svf_fd)) {
+
+	struct duration parse;
+	duration_start(&parse);
+	while (ERROR_OK == svf_read_command()) {
 		/* Log Output */
 		if (svf_quiet) {
 			if (svf_progress_enabled) {
@@ -509,9 +619,10 @@ COMMAND_HANDLER(handle_svf_command)
 		} else {
 			if (svf_progress_enabled) {
 				svf_percentage = ((svf_line_number * 20) / svf_total_lines) * 5;
-				LOG_USER_N("%3d%%  %s", svf_percentage, svf_read_line);
+				LOG_USER_N("%3d%%  %.*s\n", svf_percentage,
+						svf_read_line_len, svf_read_line);
 			} else
-				LOG_USER_N("%s", svf_read_line);
+				LOG_USER_N("%.*s\n", svf_read_line_len, svf_read_line);
 		}
 		/* Run Command */
 		if (ERROR_OK != svf_run_command(CMD_CTX, svf_command_buffer)) {
@@ -522,10 +633,10 @@ COMMAND_HANDLER(handle_svf_command)
 		command_num++;
 	}
 
-	if ((!svf_nil) && (ERROR_OK != jtag_execute_queue()))
-		ret = ERROR_FAIL;
-	else if (ERROR_OK != svf_check_tdo())
+	if (ERROR_OK != svf_execute_tap())
 		ret = ERROR_FAIL;
+	if (duration_measure(&parse) == ERROR_OK)
+		svf_parse_time = duration_elapsed(&parse) - svf_execute_time;
 
 	/* print time */
 	time_measure_ms = timeval_ms() - time_measure_ms;
@@ -539,11 +650,14 @@ COMMAND_HANDLER(handle_svf_command)
 			time_measure_m,
 			time_measure_s,
 			time_measure_ms);
+	command_print(CMD,
+		"file %s in %fs, parsed in %fs, executed in %fs",
+		svf_data_mapped ? "mapped" : "read",
+		svf_load_time, svf_parse_time, svf_execute_time);
 
 free_all:
 
-	fclose(svf_fd);
-	svf_fd = 0;
+	svf_close_file();
 
 	/* free buffers */
 	if (svf_command_buffer) {
@@ -591,76 +705,85 @@ free_all:
 	return ret;
 }
 
-static int svf_getline(char **lineptr, size_t *n, FILE *stream)
+/* Makes room for at least @a len bytes in svf_command_buffer */
+static int svf_grow_command_buffer(size_t len)
 {
-#define MIN_CHUNK 16	/* Buffer is increased by this size each time as required */
-	size_t i = 0;
-
-	if (*lineptr == NULL) {
-		*n = MIN_CHUNK;
-		*lineptr = malloc(*n);
-		if (!*lineptr)
-			return -1;
-	}
+	if (len <= svf_command_buffer_size)
+		return ERROR_OK;
 
-	(*lineptr)[0] = fgetc(stream);
-	while ((*lineptr)[i] != '\n') {
-		(*lineptr)[++i] = fgetc(stream);
-		if (feof(stream)) {
-			(*lineptr)[0] = 0;
-			return -1;
-		}
-		if ((i + 2) > *n) {
-			*n += MIN_CHUNK;
-			*lineptr = realloc(*lineptr, *n);
-		}
-	}
+	size_t size = svf_command_buffer_size ? svf_command_buffer_size : 1024;
+	while (size < len)
+		size *= 2;
 
-	(*lineptr)[++i] = 0;
+	char *ptr = realloc(svf_command_buffer, size);
+	if (!ptr) {
+		LOG_ERROR("not enough memory");
+		return ERROR_FAIL;
+	}
+	svf_command_buffer = ptr;
+	svf_command_buffer_size = size;
+	return ERROR_OK;
+}
 
-	return sizeof(*lineptr);
+/* Characters svf_read_command() has to look at one by one */
+static inline bool svf_is_plain_char(char ch)
+{
+	switch (ch) {
+		case '!':
+		case '/':
+		case ';':
+		case '\n':
+		case '\r':
+		case '(':
+		case ')':
+			return false;
+		default:
+			return true;
+	}
 }
 
-#define SVFP_CMD_INC_CNT 1024
-static int svf_read_command_from_file(FILE *fd)
+/* Collects the next command, up to its ';', from the file into
+ * svf_command_buffer. Comments are dropped, and the last line of the
+ * command is left in svf_read_line for the log. */
+static int svf_read_command(void)
 {
-	unsigned char ch;
-	int i = 0;
+	const char *p = svf_data + svf_data_pos;
+	const char *end = svf_data + svf_data_size;
+	const char *line = p;
 	size_t cmd_pos = 0;
-	int cmd_ok = 0, slash = 0;
+	int slash = 0;
 
-	if (svf_getline(&svf_read_line, &svf_read_line_size, svf_fd) <= 0)
+	if (svf_grow_command_buffer(1) != ERROR_OK)
 		return ERROR_FAIL;
-	svf_line_number++;
-	ch = svf_read_line[0];
-	while (!cmd_ok && (ch != 0)) {
+
+	while (p < end) {
+		char ch = *p++;
+
 		switch (ch) {
+			case '/':
+				/* a single '/' is dropped, the second one on a
+				 * line starts a comment */
+				if (++slash < 2)
+					break;
+				/* fallthrough */
 			case '!':
+				/* comment, up to the end of the line */
 				slash = 0;
-				if (svf_getline(&svf_read_line, &svf_read_line_size, svf_fd) <= 0)
-					return ERROR_FAIL;
-				svf_line_number++;
-				i = -1;
-				break;
-			case '/':
-				if (++slash == 2) {
-					slash = 0;
-					if (svf_getline(&svf_read_line, &svf_read_line_size,
-						svf_fd) <= 0)
-						return ERROR_FAIL;
-					svf_line_number++;
-					i = -1;
-				}
+				p = memchr(p, '\n', end - p);
+				if (!p)
+					p = end;
 				break;
 			case ';':
-				slash = 0;
-				cmd_ok = 1;
-				break;
+				svf_command_buffer[cmd_pos] = '\0';
+				while (line < p && isspace((unsigned char)*line))
+					line++;
+				svf_read_line = line;
+				svf_read_line_len = p - line;
+				svf_data_pos = p - svf_data;
+				return ERROR_OK;
 			case '\n':
 				svf_line_number++;
-				if (svf_getline(&svf_read_line, &svf_read_line_size, svf_fd) <= 0)
-					return ERROR_FAIL;
-				i = -1;
+				line = p;
 				/* fallthrough */
 			case '\r':
 				slash = 0;
@@ -681,34 +804,36 @@ static int svf_read_command_from_file(FILE *fd)
 				 *  - added space.
 				 *  - terminating NUL ('\0')
 				 */
-				if (cmd_pos + 3 > svf_command_buffer_size) {
-					svf_command_buffer = realloc(svf_command_buffer, cmd_pos + 3);
-					svf_command_buffer_size = cmd_pos + 3;
-					if (svf_command_buffer == NULL) {
-						LOG_ERROR("not enough memory");
-						return ERROR_FAIL;
-					}
-				}
+				if (cmd_pos + 3 > svf_command_buffer_size &&
+						svf_grow_command_buffer(cmd_pos + 3) != ERROR_OK)
+					return ERROR_FAIL;
 
 				/* insert a space before '(' */
 				if ('(' == ch)
 					svf_command_buffer[cmd_pos++] = ' ';
 
-				svf_command_buffer[cmd_pos++] = (char)toupper(ch);
+				svf_command_buffer[cmd_pos++] = (char)toupper((unsigned char)ch);
 
 				/* insert a space after ')' */
 				if (')' == ch)
 					svf_command_buffer[cmd_pos++] = ' ';
+
+				/* copy the plain characters that follow in one go,
+				 * this is where long bitstrings go */
+				const char *run = p;
+				while (run < end && svf_is_plain_char(*run))
+					run++;
+				if (svf_grow_command_buffer(cmd_pos + (run - p) + 3) != ERROR_OK)
+					return ERROR_FAIL;
+				while (p < run)
+					svf_command_buffer[cmd_pos++] = (char)toupper((unsigned char)*p++);
 				break;
 		}
-		ch = svf_read_line[++i];
 	}
 
-	if (cmd_ok) {
-		svf_command_buffer[cmd_pos] = '\0';
-		return ERROR_OK;
-	} else
-		return ERROR_FAIL;
+	/* no complete command left */
+	svf_data_pos = svf_data_size;
+	return ERROR_FAIL;
 }
 
 static int svf_parse_cmd_string(char *str, int len, char **argus, int *num_of_argu)
@@ -716,6 +841,13 @@ static int svf_parse_cmd_string(char *str, int len, char **argus, int *num_of_ar
 	int pos = 0, num = 0, space_found = 1, in_bracket = 0;
 
 	while (pos < len) {
+		/* data in brackets is taken as it is */
+		if (in_bracket && str[pos] != ')') {
+			const char *close = memchr(&str[pos], ')', len - pos);
+			pos = close ? close - str : len;
+			continue;
+		}
+
 		switch (str[pos]) {
 			case '!':
 			case '/':
@@ -798,10 +930,33 @@ static int svf_set_padding(struct svf_xxr_para *para, int len, unsigned char tdi
 	return error;
 }
 
-static int svf_copy_hexstring_to_binary(char *str, uint8_t **bin, int orig_bit_len, int bit_len)
+/* Value of a hexadecimal digit, SVF_HEX_SPACE for whitespace and 0xFF
+ * for anything else. */
+#define SVF_HEX_SPACE 0x10
+static const uint8_t svf_hex_value[256] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x10, 0x10, 0x10, 0x10, 0x10, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0x10, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
+
+static int svf_copy_hexstring_to_binary(const char *str, size_t str_len,
+		uint8_t **bin, int orig_bit_len, int bit_len)
 {
-	int i, str_len = strlen(str), str_hbyte_len = (bit_len + 3) >> 2;
-	uint8_t ch = 0;
+	int i, str_hbyte_len = (bit_len + 3) >> 2;
+	uint8_t ch = 0, lo, hi;
 
 	if (ERROR_OK != svf_adjust_array_length(bin, orig_bit_len, bit_len)) {
 		LOG_ERROR("fail to adjust length of array");
@@ -810,9 +965,22 @@ static int svf_copy_hexstring_to_binary(char *str, uint8_t **bin, int orig_bit_l
 
 	/* fill from LSB (end of str) to MSB (beginning of str) */
 	for (i = 0; i < str_hbyte_len; i++) {
+		/* whole bytes while the digits come in pairs */
+		if (!(i % 2) && i + 1 < str_hbyte_len && str_len >= 2) {
+			lo = svf_hex_value[(uint8_t)str[str_len - 1]];
+			hi = svf_hex_value[(uint8_t)str[str_len - 2]];
+			if ((lo | hi) < 0x10) {
+				(*bin)[i / 2] = lo | (hi << 4);
+				str_len -= 2;
+				ch = hi;
+				i++;
+				continue;
+			}
+		}
+
 		ch = 0;
 		while (str_len > 0) {
-			ch = str[--str_len];
+			lo = svf_hex_value[(uint8_t)str[--str_len]];
 
 			/* Skip whitespace.  The SVF specification (rev E) is
 			 * deficient in terms of basic lexical issues like
@@ -820,20 +988,13 @@ static int svf_copy_hexstring_to_binary(char *str, uint8_t **bin, int orig_bit_l
 			 * require line ends for correctness, since there is
 			 * a hard limit on line length.
 			 */
-			if (!isspace(ch)) {
-				if ((ch >= '0') && (ch <= '9')) {
-					ch = ch - '0';
-					break;
-				} else if ((ch >= 'A') && (ch <= 'F')) {
-					ch = ch - 'A' + 10;
-					break;
-				} else {
-					LOG_ERROR("invalid hex string");
-					return ERROR_FAIL;
-				}
+			if (lo < 0x10) {
+				ch = lo;
+				break;
+			} else if (lo != SVF_HEX_SPACE) {
+				LOG_ERROR("invalid hex string");
+				return ERROR_FAIL;
 			}
-
-			ch = 0;
 		}
 
 		/* write bin */
@@ -842,14 +1003,13 @@ static int svf_copy_hexstring_to_binary(char *str, uint8_t **bin, int orig_bit_l
 			(*bin)[i / 2] |= ch << 4;
 		} else {
 			/* LSB */
-			(*bin)[i / 2] = 0;
-			(*bin)[i / 2] |= ch;
+			(*bin)[i / 2] = ch;
 		}
 	}
 
 	/* consume optional leading '0' MSBs or whitespace */
 	while (str_len > 0 && ((str[str_len - 1] == '0')
-			|| isspace((int) str[str_len - 1])))
+			|| svf_hex_value[(uint8_t)str[str_len - 1]] == SVF_HEX_SPACE))
 		str_len--;
 
 	/* check validity: we must have consumed everything */
@@ -906,10 +1066,19 @@ static int svf_add_check_para(uint8_t enabled, int buffer_offset, int bit_len)
 
 static int svf_execute_tap(void)
 {
+	struct duration execute;
+	int retval = ERROR_OK;
+
+	duration_start(&execute);
 	if ((!svf_nil) && (ERROR_OK != jtag_execute_queue()))
-		return ERROR_FAIL;
+		retval = ERROR_FAIL;
 	else if (ERROR_OK != svf_check_tdo())
-		return ERROR_FAIL;
+		retval = ERROR_FAIL;
+
+	if (duration_measure(&execute) == ERROR_OK)
+		svf_execute_time += duration_elapsed(&execute);
+	if (retval != ERROR_OK)
+		return retval;
 
 	svf_buffer_index = 0;
 
@@ -1054,12 +1223,13 @@ XXR_common:
 			LOG_DEBUG("\tlength = %d", xxr_para_tmp->len);
 			xxr_para_tmp->data_mask = 0;
 			for (i = 2; i < num_of_argu; i += 2) {
-				if ((strlen(argus[i + 1]) < 3) || (argus[i + 1][0] != '(') ||
-				(argus[i + 1][strlen(argus[i + 1]) - 1] != ')')) {
+				size_t data_len = strlen(argus[i + 1]);
+				if ((data_len < 3) || (argus[i + 1][0] != '(') ||
+				(argus[i + 1][data_len - 1] != ')')) {
 					LOG_ERROR("data section error");
 					return ERROR_FAIL;
 				}
-				argus[i + 1][strlen(argus[i + 1]) - 1] = '\0';
+				argus[i + 1][data_len - 1] = '\0';
 				/* TDI, TDO, MASK, SMASK */
 				if (!strcmp(argus[i], "TDI")) {
 					/* TDI */
@@ -1082,8 +1252,8 @@ XXR_common:
 					return ERROR_FAIL;
 				}
 				if (ERROR_OK !=
-				svf_copy_hexstring_to_binary(&argus[i + 1][1], pbuffer_tmp, i_tmp,
-					xxr_para_tmp->len)) {
+				svf_copy_hexstring_to_binary(&argus[i + 1][1], data_len - 2,
+					pbuffer_tmp, i_tmp, xxr_para_tmp->len)) {
 					LOG_ERROR("fail to parse hex value");
 					return ERROR_FAIL;
 				}
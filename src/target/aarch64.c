@@ -2464,6 +2464,92 @@ static int aarch64_virt2phys(struct target *target, target_addr_t virt,
 	return armv8_mmu_translate_va_pa(target, virt, phys, 1);
 }
 
+static int aarch64_profiling(struct target *target, uint32_t *samples,
+		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
+{
+	struct armv8_common *armv8 = target_to_armv8(target);
+	struct timeval timeout, now;
+	uint32_t eddevid, eddevid1, sample_count = 0;
+	bool offset;
+	int retval;
+
+	retval = mem_ap_read_atomic_u32(armv8->debug_ap,
+			armv8->debug_base + CPUV8_DBG_EDDEVID, &eddevid);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if ((eddevid & CPUV8_DBG_EDDEVID_PCSAMPLE_MASK) == 0) {
+		LOG_INFO("EDPCSR not implemented on %s", target_name(target));
+		return target_profiling_default(target, samples, max_num_samples,
+				num_samples, seconds);
+	}
+
+	/* ARMv8.0 may sample AArch32 PCs with the +8 (A32) / +4 (T32) offset
+	 * and the instruction set in the low bits, as on ARMv7 */
+	retval = mem_ap_read_atomic_u32(armv8->debug_ap,
+			armv8->debug_base + CPUV8_DBG_EDDEVID1, &eddevid1);
+	if (retval != ERROR_OK)
+		return retval;
+	offset = (eddevid1 & CPUV8_DBG_EDDEVID1_PCSROFFSET_MASK) ==
+			CPUV8_DBG_EDDEVID1_PCSROFFSET_APPLIED;
+
+	LOG_INFO("Starting AArch64 profiling. Sampling EDPCSR as fast as we can...");
+
+	/* Make sure the target is running */
+	target_poll(target);
+	if (target->state == TARGET_HALTED) {
+		retval = target_resume(target, 1, 0, 0, 0);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Error while resuming target");
+			return retval;
+		}
+	}
+
+	gettimeofday(&timeout, NULL);
+	timeval_add_time(&timeout, seconds, 0);
+
+	for (;;) {
+		uint32_t read_count = max_num_samples - sample_count;
+		if (read_count > 1024)
+			read_count = 1024;
+
+		/*
+		 * Only EDPCSRlo is read; gmon samples are 32 bit and reading
+		 * the low half is what triggers a new sample.
+		 */
+		uint32_t *buf = &samples[sample_count];
+		retval = mem_ap_read_buf_noincr(armv8->debug_ap, (uint8_t *)buf,
+				4, read_count, armv8->debug_base + CPUV8_DBG_EDPCSR_LO);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Error while reading EDPCSR");
+			return retval;
+		}
+
+		for (uint32_t i = 0; i < read_count; i++) {
+			uint32_t v = le_to_h_u32((uint8_t *)&buf[i]);
+			/* All ones: PE in debug state or sampling prohibited */
+			if (v == 0xFFFFFFFF)
+				continue;
+			if (offset) {
+				if (v & 1)
+					v = (v & ~1) - 4;
+				else
+					v = (v & ~3) - 8;
+			}
+			samples[sample_count++] = v;
+		}
+
+		gettimeofday(&now, NULL);
+		if (sample_count >= max_num_samples || timeval_compare(&now, &timeout) > 0) {
+			LOG_INFO("Profiling completed. %" PRIu32 " samples.", sample_count);
+			break;
+		}
+	}
+
+	*num_samples = sample_count;
+	return ERROR_OK;
+}
+
 /*
  * private target configuration items
  */
@@ -2843,4 +2929,6 @@ struct target_type aarch64_target = {
 	.write_phys_memory = aarch64_write_phys_memory,
 	.mmu = aarch64_mmu,
 	.virt2phys = aarch64_virt2phys,
+
+	.profiling = aarch64_profiling,
 };
@@ -309,6 +309,71 @@ static int swd_queue_ap_write(struct adiv5_ap *ap, unsigned reg,
 	return check_sync(dap);
 }
 
+static int swd_queue_ap_read_buf(struct adiv5_ap *ap, unsigned reg,
+		uint32_t *data, unsigned int count)
+{
+	struct adiv5_dap *dap = ap->dap;
+	const struct swd_driver *swd = adiv5_dap_swd_driver(dap);
+	assert(swd);
+
+	if (!swd->read_reg_block || count < 2) {
+		for (unsigned int i = 0; i < count; i++) {
+			int retval = swd_queue_ap_read(ap, reg, &data[i]);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		return ERROR_OK;
+	}
+
+	int retval = swd_check_reconnect(dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = swd_queue_ap_bankselect(ap, reg);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* AP reads are posted: the first read completes the previous one,
+	 * each of the following completes the read before it and the last
+	 * value is left in RDBUFF. */
+	uint8_t cmd = swd_cmd(true,  true, reg);
+	swd->read_reg(cmd, dap->last_read, ap->memaccess_tck);
+	swd->read_reg_block(cmd, data, count - 1, ap->memaccess_tck);
+	dap->last_read = &data[count - 1];
+
+	return check_sync(dap);
+}
+
+static int swd_queue_ap_write_buf(struct adiv5_ap *ap, unsigned reg,
+		const uint32_t *data, unsigned int count)
+{
+	struct adiv5_dap *dap = ap->dap;
+	const struct swd_driver *swd = adiv5_dap_swd_driver(dap);
+	assert(swd);
+
+	if (!swd->write_reg_block || count < 2) {
+		for (unsigned int i = 0; i < count; i++) {
+			int retval = swd_queue_ap_write(ap, reg, data[i]);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		return ERROR_OK;
+	}
+
+	int retval = swd_check_reconnect(dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	swd_finish_read(dap);
+	retval = swd_queue_ap_bankselect(ap, reg);
+	if (retval != ERROR_OK)
+		return retval;
+
+	swd->write_reg_block(swd_cmd(false,  true, reg), data, count, ap->memaccess_tck);
+
+	return check_sync(dap);
+}
+
 /** Executes all queued DAP operations. */
 static int swd_run(struct adiv5_dap *dap)
 {
@@ -333,6 +398,8 @@ const struct dap_ops swd_dap_ops = {
 	.queue_dp_write = swd_queue_dp_write,
 	.queue_ap_read = swd_queue_ap_read,
 	.queue_ap_write = swd_queue_ap_write,
+	.queue_ap_read_buf = swd_queue_ap_read_buf,
+	.queue_ap_write_buf = swd_queue_ap_write_buf,
 	.queue_ap_abort = swd_queue_ap_abort,
 	.run = swd_run,
 	.quit = swd_quit,
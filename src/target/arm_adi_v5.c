@@ -181,6 +181,25 @@ static void mem_ap_update_tar_cache(struct adiv5_ap *ap)
 		ap->tar_value += inc;
 }
 
+/*
+ * Number of DRW transfers of this_size bytes each, starting at address,
+ * that can be queued back to back: TAR auto-increment carries them all
+ * without crossing a tar_autoincr_block boundary, so neither CSW nor TAR
+ * need to be rewritten in between.
+ */
+static uint32_t mem_ap_drw_run_length(struct adiv5_ap *ap, uint32_t address,
+		size_t nbytes, uint32_t this_size, bool addrinc)
+{
+	uint32_t count = nbytes / this_size;
+
+	if (addrinc) {
+		uint32_t in_block = max_tar_block_size(ap->tar_autoincr_block, address) / this_size;
+		count = MIN(count, MAX(in_block, 1));
+	}
+
+	return count;
+}
+
 /**
  * Queue transactions setting up transfer parameters for the
  * currently selected MEM-AP.
@@ -333,6 +352,7 @@ static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t siz
 	const uint32_t csw_addrincr = addrinc ? CSW_ADDRINC_SINGLE : CSW_ADDRINC_OFF;
 	uint32_t csw_size;
 	uint32_t addr_xor;
+	uint32_t drw_buf[256];
 	int retval = ERROR_OK;
 
 	/* TI BE-32 Quirks mode:
@@ -383,49 +403,60 @@ static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t siz
 		if (retval != ERROR_OK)
 			return retval;
 
+		/* Queue as many transfers as TAR auto-increment carries in one go.
+		 * The TI BE-32 sub-word writes set TAR for every transfer. */
+		uint32_t run = 1;
+		if (!addr_xor)
+			run = MIN(mem_ap_drw_run_length(ap, address, nbytes, this_size, addrinc),
+					ARRAY_SIZE(drw_buf));
+
 		/* How many source bytes each transfer will consume, and their location in the DRW,
 		 * depends on the type of transfer and alignment. See ARM document IHI0031C. */
-		uint32_t outvalue = 0;
-		uint32_t drw_byte_idx = address;
-		if (dap->ti_be_32_quirks) {
-			switch (this_size) {
-			case 4:
-				outvalue |= (uint32_t)*buffer++ << 8 * (3 ^ (drw_byte_idx++ & 3) ^ addr_xor);
-				outvalue |= (uint32_t)*buffer++ << 8 * (3 ^ (drw_byte_idx++ & 3) ^ addr_xor);
-				outvalue |= (uint32_t)*buffer++ << 8 * (3 ^ (drw_byte_idx++ & 3) ^ addr_xor);
-				outvalue |= (uint32_t)*buffer++ << 8 * (3 ^ (drw_byte_idx & 3) ^ addr_xor);
-				break;
-			case 2:
-				outvalue |= (uint32_t)*buffer++ << 8 * (1 ^ (drw_byte_idx++ & 3) ^ addr_xor);
-				outvalue |= (uint32_t)*buffer++ << 8 * (1 ^ (drw_byte_idx & 3) ^ addr_xor);
-				break;
-			case 1:
-				outvalue |= (uint32_t)*buffer++ << 8 * (0 ^ (drw_byte_idx & 3) ^ addr_xor);
-				break;
-			}
-		} else {
-			switch (this_size) {
-			case 4:
-				outvalue |= (uint32_t)*buffer++ << 8 * (drw_byte_idx++ & 3);
-				outvalue |= (uint32_t)*buffer++ << 8 * (drw_byte_idx++ & 3);
-				/* fallthrough */
-			case 2:
-				outvalue |= (uint32_t)*buffer++ << 8 * (drw_byte_idx++ & 3);
-				/* fallthrough */
-			case 1:
-				outvalue |= (uint32_t)*buffer++ << 8 * (drw_byte_idx & 3);
+		for (uint32_t i = 0; i < run; i++) {
+			uint32_t outvalue = 0;
+			uint32_t drw_byte_idx = address;
+			if (dap->ti_be_32_quirks) {
+				switch (this_size) {
+				case 4:
+					outvalue |= (uint32_t)*buffer++ << 8 * (3 ^ (drw_byte_idx++ & 3) ^ addr_xor);
+					outvalue |= (uint32_t)*buffer++ << 8 * (3 ^ (drw_byte_idx++ & 3) ^ addr_xor);
+					outvalue |= (uint32_t)*buffer++ << 8 * (3 ^ (drw_byte_idx++ & 3) ^ addr_xor);
+					outvalue |= (uint32_t)*buffer++ << 8 * (3 ^ (drw_byte_idx & 3) ^ addr_xor);
+					break;
+				case 2:
+					outvalue |= (uint32_t)*buffer++ << 8 * (1 ^ (drw_byte_idx++ & 3) ^ addr_xor);
+					outvalue |= (uint32_t)*buffer++ << 8 * (1 ^ (drw_byte_idx & 3) ^ addr_xor);
+					break;
+				case 1:
+					outvalue |= (uint32_t)*buffer++ << 8 * (0 ^ (drw_byte_idx & 3) ^ addr_xor);
+					break;
+				}
+			} else {
+				switch (this_size) {
+				case 4:
+					outvalue |= (uint32_t)*buffer++ << 8 * (drw_byte_idx++ & 3);
+					outvalue |= (uint32_t)*buffer++ << 8 * (drw_byte_idx++ & 3);
+					/* fallthrough */
+				case 2:
+					outvalue |= (uint32_t)*buffer++ << 8 * (drw_byte_idx++ & 3);
+					/* fallthrough */
+				case 1:
+					outvalue |= (uint32_t)*buffer++ << 8 * (drw_byte_idx & 3);
+				}
 			}
-		}
 
-		nbytes -= this_size;
+			drw_buf[i] = outvalue;
+			nbytes -= this_size;
+			if (addrinc)
+				address += this_size;
+		}
 
-		retval = dap_queue_ap_write(ap, MEM_AP_REG_DRW, outvalue);
+		retval = dap_queue_ap_write_buf(ap, MEM_AP_REG_DRW, drw_buf, run);
 		if (retval != ERROR_OK)
 			break;
 
-		mem_ap_update_tar_cache(ap);
-		if (addrinc)
-			address += this_size;
+		for (uint32_t i = 0; i < run; i++)
+			mem_ap_update_tar_cache(ap);
 	}
 
 	/* REVISIT: Might want to have a queued version of this function that does not run. */
@@ -443,9 +474,134 @@ static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t siz
 	return retval;
 }
 
+/* Number of DRW reads queued between two dap_run() calls in mem_ap_read().
+ * Bounds the memory used for a read, independent of its size. */
+#define MEM_AP_READ_WINDOW	4096
+
+/* One window of a mem_ap_read(): the DRW words read and where they go. */
+struct mem_ap_read_window {
+	uint32_t *words;
+	uint8_t *buffer;
+	/* target address of the first transfer */
+	uint32_t address;
+	/* bytes left in the whole read when this window starts */
+	size_t remaining;
+	/* bytes covered by the transfers queued for this window */
+	size_t nbytes;
+};
+
+/* Queue the reads of one window.  Each read will store the entire DRW word in
+ * the window. How many useful bytes it contains, and their location in the word,
+ * depends on the type of transfer and alignment. */
+static int mem_ap_read_queue_window(struct adiv5_ap *ap, struct mem_ap_read_window *win,
+		uint32_t csw_size, uint32_t csw_addrincr, uint32_t size, bool addrinc)
+{
+	uint32_t address = win->address;
+	size_t nbytes = win->remaining;
+	uint32_t used = 0;
+	int retval = ERROR_OK;
+
+	while (nbytes > 0 && used < MEM_AP_READ_WINDOW) {
+		uint32_t this_size = size;
+
+		/* Select packed transfer if possible */
+		if (addrinc && ap->packed_transfers && nbytes >= 4
+				&& max_tar_block_size(ap->tar_autoincr_block, address) >= 4) {
+			this_size = 4;
+			retval = mem_ap_setup_csw(ap, csw_size | CSW_ADDRINC_PACKED);
+		} else {
+			retval = mem_ap_setup_csw(ap, csw_size | csw_addrincr);
+		}
+		if (retval != ERROR_OK)
+			break;
+
+		retval = mem_ap_setup_tar(ap, address);
+		if (retval != ERROR_OK)
+			break;
+
+		/* Queue as many reads as TAR auto-increment carries in one go. */
+		uint32_t run = MIN(mem_ap_drw_run_length(ap, address, nbytes, this_size, addrinc),
+				MEM_AP_READ_WINDOW - used);
+
+		retval = dap_queue_ap_read_buf(ap, MEM_AP_REG_DRW, win->words + used, run);
+		if (retval != ERROR_OK)
+			break;
+
+		used += run;
+		nbytes -= run * this_size;
+		if (addrinc)
+			address += run * this_size;
+
+		for (uint32_t i = 0; i < run; i++)
+			mem_ap_update_tar_cache(ap);
+	}
+
+	win->nbytes = win->remaining - nbytes;
+	return retval;
+}
+
+/* Populate the caller's buffer with the first nbytes of a window, from the
+ * correct word and byte lane. Mirrors mem_ap_read_queue_window(). */
+static void mem_ap_read_unpack_window(struct adiv5_ap *ap, const struct mem_ap_read_window *win,
+		size_t nbytes, uint32_t size, bool addrinc)
+{
+	struct adiv5_dap *dap = ap->dap;
+	const uint32_t *read_ptr = win->words;
+	uint8_t *buffer = win->buffer;
+	uint32_t address = win->address;
+	size_t remaining = win->remaining;
+
+	while (nbytes > 0) {
+		uint32_t this_size = size;
+
+		if (addrinc && ap->packed_transfers && remaining >= 4
+				&& max_tar_block_size(ap->tar_autoincr_block, address) >= 4) {
+			this_size = 4;
+		}
+
+		/* Partial window after an error */
+		if (this_size > nbytes)
+			break;
+
+		if (dap->ti_be_32_quirks) {
+			switch (this_size) {
+			case 4:
+				*buffer++ = *read_ptr >> 8 * (3 - (address++ & 3));
+				*buffer++ = *read_ptr >> 8 * (3 - (address++ & 3));
+				/* fallthrough */
+			case 2:
+				*buffer++ = *read_ptr >> 8 * (3 - (address++ & 3));
+				/* fallthrough */
+			case 1:
+				*buffer++ = *read_ptr >> 8 * (3 - (address++ & 3));
+			}
+		} else {
+			switch (this_size) {
+			case 4:
+				*buffer++ = *read_ptr >> 8 * (address++ & 3);
+				*buffer++ = *read_ptr >> 8 * (address++ & 3);
+				/* fallthrough */
+			case 2:
+				*buffer++ = *read_ptr >> 8 * (address++ & 3);
+				/* fallthrough */
+			case 1:
+				*buffer++ = *read_ptr >> 8 * (address++ & 3);
+			}
+		}
+
+		read_ptr++;
+		nbytes -= this_size;
+		remaining -= this_size;
+	}
+}
+
 /**
  * Synchronous read of a block of memory, using a specific access size.
  *
+ * The read is done in windows of at most MEM_AP_READ_WINDOW transfers. The
+ * next window is queued before the previous one is unpacked, so adapters that
+ * send as they queue keep the link busy meanwhile.
+ *
  * @param ap The MEM-AP to access.
  * @param buffer The data buffer to receive the data. No particular alignment is assumed.
  * @param size Which access size to use, in bytes. 1, 2 or 4.
@@ -459,10 +615,8 @@ static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint
 		uint32_t adr, bool addrinc)
 {
 	struct adiv5_dap *dap = ap->dap;
-	size_t nbytes = size * count;
 	const uint32_t csw_addrincr = addrinc ? CSW_ADDRINC_SINGLE : CSW_ADDRINC_OFF;
 	uint32_t csw_size;
-	uint32_t address = adr;
 	int retval = ERROR_OK;
 
 	/* TI BE-32 Quirks mode:
@@ -484,109 +638,67 @@ static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint
 	if (ap->unaligned_access_bad && (adr % size != 0))
 		return ERROR_TARGET_UNALIGNED_ACCESS;
 
-	/* Allocate buffer to hold the sequence of DRW reads that will be made. This is a significant
-	 * over-allocation if packed transfers are going to be used, but determining the real need at
-	 * this point would be messy. */
-	uint32_t *read_buf = calloc(count, sizeof(uint32_t));
-	/* Multiplication count * sizeof(uint32_t) may overflow, calloc() is safe */
-	uint32_t *read_ptr = read_buf;
+	if (count == 0)
+		return ERROR_OK;
+
+	/* Two windows: one in flight, one being unpacked. Each holds at most one
+	 * word per transfer, which over-allocates if packed transfers are used. */
+	uint32_t window_words = MIN(count, MEM_AP_READ_WINDOW);
+	struct mem_ap_read_window ring[2];
+	uint32_t *read_buf = calloc(2 * window_words, sizeof(uint32_t));
 	if (read_buf == NULL) {
 		LOG_ERROR("Failed to allocate read buffer");
 		return ERROR_FAIL;
 	}
+	ring[0].words = read_buf;
+	ring[1].words = read_buf + window_words;
 
-	/* Queue up all reads. Each read will store the entire DRW word in the read buffer. How many
-	 * useful bytes it contains, and their location in the word, depends on the type of transfer
-	 * and alignment. */
-	while (nbytes > 0) {
-		uint32_t this_size = size;
+	struct mem_ap_read_window *win = &ring[0];
+	win->buffer = buffer;
+	win->address = adr;
+	win->remaining = (size_t)size * count;
 
-		/* Select packed transfer if possible */
-		if (addrinc && ap->packed_transfers && nbytes >= 4
-				&& max_tar_block_size(ap->tar_autoincr_block, address) >= 4) {
-			this_size = 4;
-			retval = mem_ap_setup_csw(ap, csw_size | CSW_ADDRINC_PACKED);
-		} else {
-			retval = mem_ap_setup_csw(ap, csw_size | csw_addrincr);
-		}
-		if (retval != ERROR_OK)
-			break;
+	retval = mem_ap_read_queue_window(ap, win, csw_size, csw_addrincr, size, addrinc);
 
-		retval = mem_ap_setup_tar(ap, address);
+	while (retval == ERROR_OK) {
+		retval = dap_run(dap);
 		if (retval != ERROR_OK)
 			break;
 
-		retval = dap_queue_ap_read(ap, MEM_AP_REG_DRW, read_ptr++);
-		if (retval != ERROR_OK)
-			break;
+		/* Get the next window going before unpacking this one */
+		struct mem_ap_read_window *next = NULL;
+		if (win->nbytes < win->remaining) {
+			next = (win == &ring[0]) ? &ring[1] : &ring[0];
+			next->buffer = win->buffer + win->nbytes;
+			next->address = addrinc ? win->address + win->nbytes : win->address;
+			next->remaining = win->remaining - win->nbytes;
+			retval = mem_ap_read_queue_window(ap, next, csw_size, csw_addrincr, size, addrinc);
+		}
 
-		nbytes -= this_size;
-		if (addrinc)
-			address += this_size;
+		mem_ap_read_unpack_window(ap, win, win->nbytes, size, addrinc);
+		keep_alive();
 
-		mem_ap_update_tar_cache(ap);
+		win = next;
+		if (!win)
+			break;
 	}
 
-	if (retval == ERROR_OK)
-		retval = dap_run(dap);
-
-	/* Restore state */
-	address = adr;
-	nbytes = size * count;
-	read_ptr = read_buf;
-
 	/* If something failed, read TAR to find out how much data was successfully read, so we can
 	 * at least give the caller what we have. */
 	if (retval != ERROR_OK) {
+		size_t nbytes = win->nbytes;
 		uint32_t tar;
 		if (mem_ap_read_tar(ap, &tar) == ERROR_OK) {
 			/* TAR is incremented after failed transfer on some devices (eg Cortex-M4) */
 			LOG_ERROR("Failed to read memory at 0x%08"PRIx32, tar);
-			if (nbytes > tar - address)
-				nbytes = tar - address;
+			if (nbytes > tar - win->address)
+				nbytes = tar - win->address;
 		} else {
 			LOG_ERROR("Failed to read memory and, additionally, failed to find out where");
 			nbytes = 0;
 		}
-	}
-
-	/* Replay loop to populate caller's buffer from the correct word and byte lane */
-	while (nbytes > 0) {
-		uint32_t this_size = size;
-
-		if (addrinc && ap->packed_transfers && nbytes >= 4
-				&& max_tar_block_size(ap->tar_autoincr_block, address) >= 4) {
-			this_size = 4;
-		}
-
-		if (dap->ti_be_32_quirks) {
-			switch (this_size) {
-			case 4:
-				*buffer++ = *read_ptr >> 8 * (3 - (address++ & 3));
-				*buffer++ = *read_ptr >> 8 * (3 - (address++ & 3));
-				/* fallthrough */
-			case 2:
-				*buffer++ = *read_ptr >> 8 * (3 - (address++ & 3));
-				/* fallthrough */
-			case 1:
-				*buffer++ = *read_ptr >> 8 * (3 - (address++ & 3));
-			}
-		} else {
-			switch (this_size) {
-			case 4:
-				*buffer++ = *read_ptr >> 8 * (address++ & 3);
-				*buffer++ = *read_ptr >> 8 * (address++ & 3);
-				/* fallthrough */
-			case 2:
-				*buffer++ = *read_ptr >> 8 * (address++ & 3);
-				/* fallthrough */
-			case 1:
-				*buffer++ = *read_ptr >> 8 * (address++ & 3);
-			}
-		}
 
-		read_ptr++;
-		nbytes -= this_size;
+		mem_ap_read_unpack_window(ap, win, nbytes, size, addrinc);
 	}
 
 	free(read_buf);
@@ -324,6 +324,13 @@ struct dap_ops {
 	int (*queue_ap_write)(struct adiv5_ap *ap, unsigned reg,
 			uint32_t data);
 
+	/** Optional; repeated reads of one AP register. */
+	int (*queue_ap_read_buf)(struct adiv5_ap *ap, unsigned reg,
+			uint32_t *data, unsigned int count);
+	/** Optional; repeated writes to one AP register. */
+	int (*queue_ap_write_buf)(struct adiv5_ap *ap, unsigned reg,
+			const uint32_t *data, unsigned int count);
+
 	/** AP operation abort. */
 	int (*queue_ap_abort)(struct adiv5_dap *dap, uint8_t *ack);
 
@@ -442,6 +449,60 @@ static inline int dap_queue_ap_write(struct adiv5_ap *ap,
 	return ap->dap->ops->queue_ap_write(ap, reg, data);
 }
 
+/**
+ * Queue @a count reads of the same AP register, e.g. DRW with TAR
+ * auto-increment.  Transports that can't do better fall back to one
+ * dap_queue_ap_read() per word.
+ *
+ * @param ap The AP used for reading.
+ * @param reg The number of the AP register being read.
+ * @param data Where to store the register's values (in host endianness).
+ * @param count Number of reads.
+ *
+ * @return ERROR_OK for success, else a fault code.
+ */
+static inline int dap_queue_ap_read_buf(struct adiv5_ap *ap,
+		unsigned reg, uint32_t *data, unsigned int count)
+{
+	assert(ap->dap->ops != NULL);
+	if (ap->dap->ops->queue_ap_read_buf)
+		return ap->dap->ops->queue_ap_read_buf(ap, reg, data, count);
+
+	for (unsigned int i = 0; i < count; i++) {
+		int retval = ap->dap->ops->queue_ap_read(ap, reg, &data[i]);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	return ERROR_OK;
+}
+
+/**
+ * Queue @a count writes to the same AP register.  The values are
+ * consumed before returning, @a data need not stay valid until the
+ * queue is run.
+ *
+ * @param ap The AP used for writing.
+ * @param reg The number of the AP register being written.
+ * @param data Values being written (host endianness).
+ * @param count Number of writes.
+ *
+ * @return ERROR_OK for success, else a fault code.
+ */
+static inline int dap_queue_ap_write_buf(struct adiv5_ap *ap,
+		unsigned reg, const uint32_t *data, unsigned int count)
+{
+	assert(ap->dap->ops != NULL);
+	if (ap->dap->ops->queue_ap_write_buf)
+		return ap->dap->ops->queue_ap_write_buf(ap, reg, data, count);
+
+	for (unsigned int i = 0; i < count; i++) {
+		int retval = ap->dap->ops->queue_ap_write(ap, reg, data[i]);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	return ERROR_OK;
+}
+
 /**
  * Queue an AP abort operation.  The current AP transaction is aborted,
  * including any update of the transaction counter.  The AP is left in
@@ -279,6 +279,16 @@ static inline bool is_armv8(struct armv8_common *armv8)
 #define CPUV8_DBG_OSLAR		0x300
 
 #define CPUV8_DBG_AUTHSTATUS	0xFB8
+#define CPUV8_DBG_EDDEVID1	0xFC4
+#define CPUV8_DBG_EDDEVID	0xFC8
+
+/* EDDEVID.PCSample and EDDEVID1.PCSROffset */
+#define CPUV8_DBG_EDDEVID_PCSAMPLE_MASK		0xF
+#define CPUV8_DBG_EDDEVID1_PCSROFFSET_MASK	0xF
+#define CPUV8_DBG_EDDEVID1_PCSROFFSET_APPLIED	0x1
+
+#define CPUV8_DBG_EDPCSR_LO	0x0A0
+#define CPUV8_DBG_EDPCSR_HI	0x0AC
 
 #define PAGE_SIZE_4KB				0x1000
 #define PAGE_SIZE_4KB_LEVEL0_BITS	39
@@ -3006,6 +3006,115 @@ static int cortex_a_virt2phys(struct target *target,
 						    phys, 1);
 }
 
+/*
+ * Find the PC sampling register.  ARMv7.1 debug describes it in DBGDEVID
+ * and puts it at 0x0A0; plain ARMv7 debug flags it in DBGDIDR and puts
+ * it at 0x084, as the read side of DBGITR.  *offset is set when the
+ * sampled value carries the usual +8 (ARM) / +4 (Thumb) PC offset.
+ */
+static int cortex_a_find_pcsr(struct target *target, uint32_t *pcsr, bool *offset)
+{
+	struct cortex_a_common *cortex_a = target_to_cortex_a(target);
+	struct armv7a_common *armv7a = &cortex_a->armv7a_common;
+	uint32_t devid, devid1;
+	int retval;
+
+	*pcsr = 0;
+	*offset = true;
+
+	if (cortex_a->didr & CPUDBG_DIDR_DEVID_IMP) {
+		retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
+				armv7a->debug_base + CPUDBG_DEVID, &devid);
+		if (retval != ERROR_OK)
+			return retval;
+		if ((devid & CPUDBG_DEVID_PCSAMPLE_MASK) == 0)
+			return ERROR_OK;
+
+		retval = mem_ap_read_atomic_u32(armv7a->debug_ap,
+				armv7a->debug_base + CPUDBG_DEVID1, &devid1);
+		if (retval != ERROR_OK)
+			return retval;
+		*pcsr = CPUDBG_PCSR_V71;
+		*offset = (devid1 & CPUDBG_DEVID1_PCSROFFSET_MASK) !=
+				CPUDBG_DEVID1_PCSROFFSET_NONE;
+	} else if (cortex_a->didr & CPUDBG_DIDR_PCSR_IMP) {
+		*pcsr = CPUDBG_PCSR;
+	}
+
+	return ERROR_OK;
+}
+
+static int cortex_a_profiling(struct target *target, uint32_t *samples,
+		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
+{
+	struct armv7a_common *armv7a = target_to_armv7a(target);
+	struct timeval timeout, now;
+	uint32_t pcsr, sample_count = 0;
+	bool offset;
+	int retval;
+
+	retval = cortex_a_find_pcsr(target, &pcsr, &offset);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (pcsr == 0) {
+		LOG_INFO("PCSR not implemented on %s", target_name(target));
+		return target_profiling_default(target, samples, max_num_samples,
+				num_samples, seconds);
+	}
+
+	LOG_INFO("Starting Cortex-A profiling. Sampling DBGPCSR as fast as we can...");
+
+	/* Make sure the target is running */
+	target_poll(target);
+	if (target->state == TARGET_HALTED) {
+		retval = target_resume(target, 1, 0, 0, 0);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Error while resuming target");
+			return retval;
+		}
+	}
+
+	gettimeofday(&timeout, NULL);
+	timeval_add_time(&timeout, seconds, 0);
+
+	for (;;) {
+		uint32_t read_count = max_num_samples - sample_count;
+		if (read_count > 1024)
+			read_count = 1024;
+
+		/* Samples are fetched in place and then compacted. */
+		uint32_t *buf = &samples[sample_count];
+		retval = mem_ap_read_buf_noincr(armv7a->debug_ap, (uint8_t *)buf,
+				4, read_count, armv7a->debug_base + pcsr);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Error while reading PCSR");
+			return retval;
+		}
+
+		for (uint32_t i = 0; i < read_count; i++) {
+			uint32_t v = le_to_h_u32((uint8_t *)&buf[i]);
+			/* All ones: core in debug state or sampling prohibited */
+			if (v == 0xFFFFFFFF)
+				continue;
+			if (v & 1)
+				v = (v & ~1) - (offset ? 4 : 0);
+			else
+				v = (v & ~3) - (offset ? 8 : 0);
+			samples[sample_count++] = v;
+		}
+
+		gettimeofday(&now, NULL);
+		if (sample_count >= max_num_samples || timeval_compare(&now, &timeout) > 0) {
+			LOG_INFO("Profiling completed. %" PRIu32 " samples.", sample_count);
+			break;
+		}
+	}
+
+	*num_samples = sample_count;
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(cortex_a_handle_cache_info_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
@@ -3184,6 +3293,8 @@ struct target_type cortexa_target = {
 	.write_phys_memory = cortex_a_write_phys_memory,
 	.mmu = cortex_a_mmu,
 	.virt2phys = cortex_a_virt2phys,
+
+	.profiling = cortex_a_profiling,
 };
 
 static const struct command_registration cortex_r4_exec_command_handlers[] = {
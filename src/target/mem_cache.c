@@ -0,0 +1,345 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "mem_cache.h"
+#include <helper/log.h>
+
+/*
+ * GDB tends to read the same few hundred bytes of stack and data over
+ * and over while the target sits halted: every step re-reads the frame,
+ * every backtrace re-walks it.  On slow adapters each of those reads is
+ * a full round trip.  This keeps a small fully associative set of
+ * aligned pages, filled on demand through target_read_buffer().
+ *
+ * The contents are only trusted while the target stays halted.  Any
+ * target event, reset, step, memory write or register write drops them.
+ * Address ranges declared volatile (peripheral registers, mailboxes) are
+ * never cached.
+ */
+
+#define MEM_CACHE_PAGE_SIZE	256
+#define MEM_CACHE_PAGES		64
+
+struct mem_cache_page {
+	bool valid;
+	target_addr_t address;
+	unsigned int last_use;
+	uint8_t data[MEM_CACHE_PAGE_SIZE];
+};
+
+struct mem_cache_range {
+	target_addr_t address;
+	target_addr_t size;
+	struct mem_cache_range *next;
+};
+
+struct mem_cache {
+	bool enabled;
+	unsigned int clock;
+	uint32_t hits;
+	uint32_t misses;
+	struct mem_cache_range *volatile_ranges;
+	struct mem_cache_page pages[MEM_CACHE_PAGES];
+};
+
+static bool mem_cache_callbacks_registered;
+
+void mem_cache_invalidate(struct target *target)
+{
+	struct mem_cache *cache = target->mem_cache;
+
+	if (!cache)
+		return;
+
+	for (int i = 0; i < MEM_CACHE_PAGES; i++)
+		cache->pages[i].valid = false;
+}
+
+void mem_cache_invalidate_range(struct target *target, target_addr_t address,
+		uint32_t size)
+{
+	struct mem_cache *cache = target->mem_cache;
+
+	if (!cache || size == 0)
+		return;
+
+	target_addr_t last = address + size - 1;
+	for (int i = 0; i < MEM_CACHE_PAGES; i++) {
+		struct mem_cache_page *page = &cache->pages[i];
+		if (page->valid && page->address <= last &&
+				address <= page->address + MEM_CACHE_PAGE_SIZE - 1)
+			page->valid = false;
+	}
+}
+
+void mem_cache_free(struct target *target)
+{
+	struct mem_cache *cache = target->mem_cache;
+
+	if (!cache)
+		return;
+
+	struct mem_cache_range *range = cache->volatile_ranges;
+	while (range) {
+		struct mem_cache_range *next = range->next;
+		free(range);
+		range = next;
+	}
+
+	free(cache);
+	target->mem_cache = NULL;
+}
+
+static int mem_cache_event_callback(struct target *target,
+		enum target_event event, void *priv)
+{
+	/* None of these change what the halted target's memory holds. */
+	switch (event) {
+	case TARGET_EVENT_GDB_ATTACH:
+	case TARGET_EVENT_GDB_DETACH:
+	case TARGET_EVENT_TRACE_CONFIG:
+		break;
+	default:
+		mem_cache_invalidate(target);
+		break;
+	}
+
+	return ERROR_OK;
+}
+
+static int mem_cache_reset_callback(struct target *target,
+		enum target_reset_mode reset_mode, void *priv)
+{
+	mem_cache_invalidate(target);
+	return ERROR_OK;
+}
+
+static bool mem_cache_is_volatile(struct mem_cache *cache,
+		target_addr_t address, target_addr_t last)
+{
+	for (struct mem_cache_range *range = cache->volatile_ranges; range; range = range->next) {
+		if (range->address <= last && address <= range->address + range->size - 1)
+			return true;
+	}
+
+	return false;
+}
+
+/* Return the page holding @a address, filling a victim slot on a miss. */
+static struct mem_cache_page *mem_cache_lookup(struct target *target,
+		target_addr_t address)
+{
+	struct mem_cache *cache = target->mem_cache;
+	struct mem_cache_page *victim = NULL;
+
+	for (int i = 0; i < MEM_CACHE_PAGES; i++) {
+		struct mem_cache_page *page = &cache->pages[i];
+		if (page->valid && page->address == address) {
+			page->last_use = ++cache->clock;
+			cache->hits++;
+			return page;
+		}
+		if (!victim || !page->valid ||
+				(victim->valid && page->last_use < victim->last_use))
+			victim = page;
+	}
+
+	victim->valid = false;
+	int retval = target_read_buffer(target, address, MEM_CACHE_PAGE_SIZE, victim->data);
+	if (retval != ERROR_OK)
+		return NULL;
+
+	cache->misses++;
+	victim->valid = true;
+	victim->address = address;
+	victim->last_use = ++cache->clock;
+	return victim;
+}
+
+int target_read_buffer_cached(struct target *target, target_addr_t address,
+		uint32_t size, uint8_t *buffer)
+{
+	struct mem_cache *cache = target->mem_cache;
+
+	if (!cache || !cache->enabled || target->state != TARGET_HALTED)
+		return target_read_buffer(target, address, size, buffer);
+
+	while (size > 0) {
+		target_addr_t page_address = address & ~(target_addr_t)(MEM_CACHE_PAGE_SIZE - 1);
+		uint32_t offset = address - page_address;
+		uint32_t chunk = MIN(size, MEM_CACHE_PAGE_SIZE - offset);
+		struct mem_cache_page *page = NULL;
+
+		if (!mem_cache_is_volatile(cache, page_address,
+					page_address + MEM_CACHE_PAGE_SIZE - 1))
+			page = mem_cache_lookup(target, page_address);
+
+		if (page) {
+			memcpy(buffer, page->data + offset, chunk);
+		} else {
+			/* Volatile, or the rest of the page is not readable:
+			 * fetch exactly what was asked for, uncached. */
+			int retval = target_read_buffer(target, address, chunk, buffer);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+
+		address += chunk;
+		buffer += chunk;
+		size -= chunk;
+	}
+
+	return ERROR_OK;
+}
+
+static struct mem_cache *mem_cache_get(struct target *target)
+{
+	if (!target->mem_cache) {
+		target->mem_cache = calloc(1, sizeof(struct mem_cache));
+		if (!target->mem_cache)
+			return NULL;
+	}
+
+	if (!mem_cache_callbacks_registered) {
+		target_register_event_callback(mem_cache_event_callback, NULL);
+		target_register_reset_callback(mem_cache_reset_callback, NULL);
+		mem_cache_callbacks_registered = true;
+	}
+
+	return target->mem_cache;
+}
+
+COMMAND_HANDLER(handle_mem_cache_enable_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		bool enable;
+		COMMAND_PARSE_ENABLE(CMD_ARGV[0], enable);
+
+		if (enable) {
+			struct mem_cache *cache = mem_cache_get(target);
+			if (!cache) {
+				LOG_ERROR("out of memory");
+				return ERROR_FAIL;
+			}
+			cache->enabled = true;
+		} else if (target->mem_cache) {
+			mem_cache_invalidate(target);
+			target->mem_cache->enabled = false;
+		}
+	}
+
+	struct mem_cache *cache = target->mem_cache;
+	if (cache && cache->enabled)
+		command_print(CMD, "memory cache enabled, %" PRIu32 " hits, %" PRIu32 " misses",
+				cache->hits, cache->misses);
+	else
+		command_print(CMD, "memory cache disabled");
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_mem_cache_volatile_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (CMD_ARGC == 2) {
+		target_addr_t address, size;
+		COMMAND_PARSE_ADDRESS(CMD_ARGV[0], address);
+		COMMAND_PARSE_ADDRESS(CMD_ARGV[1], size);
+		if (size == 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+
+		struct mem_cache *cache = mem_cache_get(target);
+		struct mem_cache_range *range = malloc(sizeof(*range));
+		if (!cache || !range) {
+			free(range);
+			LOG_ERROR("out of memory");
+			return ERROR_FAIL;
+		}
+		range->address = address;
+		range->size = size;
+		range->next = cache->volatile_ranges;
+		cache->volatile_ranges = range;
+
+		mem_cache_invalidate(target);
+	} else if (CMD_ARGC != 0) {
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	if (target->mem_cache) {
+		for (struct mem_cache_range *range = target->mem_cache->volatile_ranges;
+				range; range = range->next)
+			command_print(CMD, TARGET_ADDR_FMT " size " TARGET_ADDR_FMT,
+					range->address, range->size);
+	}
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_mem_cache_flush_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	mem_cache_invalidate(get_current_target(CMD_CTX));
+	return ERROR_OK;
+}
+
+static const struct command_registration mem_cache_subcommand_handlers[] = {
+	{
+		.name = "enable",
+		.handler = handle_mem_cache_enable_command,
+		.mode = COMMAND_ANY,
+		.help = "Enable or disable caching of target memory reads "
+			"made by the GDB server while the target is halted",
+		.usage = "['on'|'off']",
+	},
+	{
+		.name = "volatile",
+		.handler = handle_mem_cache_volatile_command,
+		.mode = COMMAND_ANY,
+		.help = "Exclude an address range from the memory cache, "
+			"or list the excluded ranges",
+		.usage = "[address size]",
+	},
+	{
+		.name = "flush",
+		.handler = handle_mem_cache_flush_command,
+		.mode = COMMAND_EXEC,
+		.help = "Drop all cached memory contents",
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+const struct command_registration mem_cache_command_handlers[] = {
+	{
+		.name = "memcache",
+		.mode = COMMAND_ANY,
+		.help = "GDB memory read cache commands",
+		.usage = "",
+		.chain = mem_cache_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
@@ -0,0 +1,49 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_TARGET_MEM_CACHE_H
+#define OPENOCD_TARGET_MEM_CACHE_H
+
+#include "target.h"
+#include <helper/command.h>
+
+/**
+ * @file
+ * Optional per-target cache of target memory, used to answer repeated
+ * debugger reads while the target is halted.  Every transition out of
+ * the halted state, and every memory or register write, drops it.
+ */
+
+struct mem_cache;
+
+extern const struct command_registration mem_cache_command_handlers[];
+
+/**
+ * Read @a size bytes at @a address like target_read_buffer(), serving
+ * whole cache pages where possible.  Falls through to a plain
+ * target_read_buffer() when the cache is disabled or the target is not
+ * halted.
+ */
+int target_read_buffer_cached(struct target *target, target_addr_t address,
+		uint32_t size, uint8_t *buffer);
+
+/** Drop cached pages overlapping [address, address + size). */
+void mem_cache_invalidate_range(struct target *target, target_addr_t address,
+		uint32_t size);
+/** Drop all cached pages of @a target. */
+void mem_cache_invalidate(struct target *target);
+void mem_cache_free(struct target *target);
+
+#endif /* OPENOCD_TARGET_MEM_CACHE_H */
@@ -2015,8 +2015,41 @@ static int read_memory_bus_v0(struct target *target, target_addr_t address,
 	return ERROR_OK;
 }
 
+static int batch_run(const struct target *target, struct riscv_batch *batch)
+{
+	RISCV013_INFO(info);
+	RISCV_INFO(r);
+	if (r->reset_delays_wait >= 0) {
+		r->reset_delays_wait -= batch->used_scans;
+		if (r->reset_delays_wait <= 0) {
+			batch->idle_count = 0;
+			info->dmi_busy_delay = 0;
+			info->ac_busy_delay = 0;
+		}
+	}
+	return riscv_batch_run(batch);
+}
+
+/* JTAG scans per batch of system bus accesses. */
+#define SB_BATCH_SCANS		256
+
+static const unsigned int sb_data_regs[] = {
+	DMI_SBDATA0, DMI_SBDATA1, DMI_SBDATA2, DMI_SBDATA3
+};
+
+/* Words of the given size that fit in one batch, leaving room for an sbcs
+ * access and the final NOP. */
+static uint32_t sb_batch_words(uint32_t size)
+{
+	return (SB_BATCH_SCANS - 2) / (2 * DIV_ROUND_UP(size, 4));
+}
+
 /**
  * Read the requested memory using the system bus interface.
+ *
+ * The reads of sbdata are queued in batches. With sbreadondata set, every
+ * read of sbdata0 starts the next bus access, so the bus is kept streaming
+ * while the words come back in the same JTAG transaction.
  */
 static int read_memory_bus_v1(struct target *target, target_addr_t address,
 		uint32_t size, uint32_t count, uint8_t *buffer)
@@ -2024,12 +2057,13 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 	RISCV013_INFO(info);
 	target_addr_t next_address = address;
 	target_addr_t end_address = address + count * size;
+	unsigned int regs = DIV_ROUND_UP(size, 4);
 
 	while (next_address < end_address) {
 		uint32_t sbcs = set_field(0, DMI_SBCS_SBREADONADDR, 1);
 		sbcs |= sb_sbaccess(size);
 		sbcs = set_field(sbcs, DMI_SBCS_SBAUTOINCREMENT, 1);
-		sbcs = set_field(sbcs, DMI_SBCS_SBREADONDATA, count > 1);
+		sbcs = set_field(sbcs, DMI_SBCS_SBREADONDATA, next_address + size < end_address);
 		dmi_write(target, DMI_SBCS, sbcs);
 
 		/* This address write will trigger the first read. */
@@ -2043,25 +2077,88 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 			}
 		}
 
-		for (uint32_t i = (next_address - address) / size; i < count - 1; i++) {
-			read_memory_bus_word(target, address + i * size, size,
-					buffer + i * size);
-		}
+		/* The idle cycles after each scan give the bus time for the access
+		 * started by the previous read of sbdata0. */
+		bool dmi_busy = false;
+		uint32_t i = (next_address - address) / size;
+		while (i < count && !dmi_busy) {
+			struct riscv_batch *batch = riscv_batch_alloc(target, SB_BATCH_SCANS,
+					info->dmi_busy_delay + info->bus_master_read_delay);
+			uint32_t batch_first = i;
+			uint32_t batch_end = MIN(count, i + sb_batch_words(size));
+
+			for (; i < batch_end; i++) {
+				if (i == count - 1 && get_field(sbcs, DMI_SBCS_SBREADONDATA)) {
+					/* Don't start another access after the last one. */
+					sbcs = set_field(sbcs, DMI_SBCS_SBREADONDATA, 0);
+					riscv_batch_add_dmi_write(batch, DMI_SBCS, sbcs);
+				}
+				/* sbdata0 last, since reading it starts the next access */
+				for (int r = regs - 1; r >= 0; r--)
+					riscv_batch_add_dmi_read(batch, sb_data_regs[r]);
+			}
 
-		sbcs = set_field(sbcs, DMI_SBCS_SBREADONDATA, 0);
-		dmi_write(target, DMI_SBCS, sbcs);
+			if (batch_run(target, batch) != ERROR_OK) {
+				riscv_batch_free(batch);
+				return ERROR_FAIL;
+			}
 
-		read_memory_bus_word(target, address + (count - 1) * size, size,
-				buffer + (count - 1) * size);
+			size_t key = 0;
+			for (uint32_t j = batch_first; j < batch_end && !dmi_busy; j++) {
+				for (int r = regs - 1; r >= 0; r--) {
+					uint64_t dmi_out = riscv_batch_get_dmi_read(batch, key++);
+					dmi_status_t status = get_field(dmi_out, DTM_DMI_OP);
+					if (status == DMI_STATUS_BUSY) {
+						/* This and everything after it was dropped;
+						 * continue from the last complete word. */
+						next_address = address + j * size;
+						dmi_busy = true;
+						break;
+					} else if (status != DMI_STATUS_SUCCESS) {
+						LOG_ERROR("Failed system bus read at 0x%" TARGET_PRIxADDR
+								"; status=%d", address + j * size, status);
+						riscv_batch_free(batch);
+						return ERROR_FAIL;
+					}
+					uint32_t value = get_field(dmi_out, DTM_DMI_DATA);
+					write_to_buf(buffer + j * size + 4 * r, value,
+							r ? 4 : MIN(size, 4));
+					log_memory_access(address + j * size + 4 * r, value,
+							r ? 4 : MIN(size, 4), true);
+				}
+			}
+
+			riscv_batch_free(batch);
+		}
+
+		if (dmi_busy) {
+			/* Clear the sticky busy, stop the bus from streaming on, and
+			 * start over from the last confirmed address. */
+			increase_dmi_busy_delay(target);
+			if (read_sbcs_nonbusy(target, &sbcs) != ERROR_OK)
+				return ERROR_FAIL;
+			dmi_write(target, DMI_SBCS, DMI_SBCS_SBBUSYERROR);
+			continue;
+		}
 
 		if (read_sbcs_nonbusy(target, &sbcs) != ERROR_OK)
 			return ERROR_FAIL;
 
 		if (get_field(sbcs, DMI_SBCS_SBBUSYERROR)) {
-			/* We read while the target was busy. Slow down and try again. */
+			/* We read while the target was busy. Slow down and try again.
+			 * This also clears sbreadondata, so no new access starts. */
 			dmi_write(target, DMI_SBCS, DMI_SBCS_SBBUSYERROR);
 			next_address = sb_read_address(target);
+			/* The last access that completed is waiting in sbdata, but
+			 * what we got for it was read too early. */
+			if (next_address >= address + size && next_address <= end_address) {
+				if (read_memory_bus_word(target, next_address - size, size,
+							buffer + next_address - size - address) != ERROR_OK)
+					return ERROR_FAIL;
+			}
 			info->bus_master_read_delay += info->bus_master_read_delay / 10 + 1;
+			LOG_DEBUG("sbbusyerror, bus_master_read_delay=%d",
+					info->bus_master_read_delay);
 			continue;
 		}
 
@@ -2079,21 +2176,6 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 	return ERROR_OK;
 }
 
-static int batch_run(const struct target *target, struct riscv_batch *batch)
-{
-	RISCV013_INFO(info);
-	RISCV_INFO(r);
-	if (r->reset_delays_wait >= 0) {
-		r->reset_delays_wait -= batch->used_scans;
-		if (r->reset_delays_wait <= 0) {
-			batch->idle_count = 0;
-			info->dmi_busy_delay = 0;
-			info->ac_busy_delay = 0;
-		}
-	}
-	return riscv_batch_run(batch);
-}
-
 /**
  * Read the requested memory, taking care to execute every read exactly once,
  * even if cmderr=busy is encountered.
@@ -2508,43 +2590,71 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 
 	sb_write_address(target, next_address);
 	while (next_address < end_address) {
-		for (uint32_t i = (next_address - address) / size; i < count; i++) {
-			const uint8_t *p = buffer + i * size;
-			if (size > 12)
-				dmi_write(target, DMI_SBDATA3,
-						((uint32_t) p[12]) |
-						(((uint32_t) p[13]) << 8) |
-						(((uint32_t) p[14]) << 16) |
-						(((uint32_t) p[15]) << 24));
-			if (size > 8)
-				dmi_write(target, DMI_SBDATA2,
-						((uint32_t) p[8]) |
-						(((uint32_t) p[9]) << 8) |
-						(((uint32_t) p[10]) << 16) |
-						(((uint32_t) p[11]) << 24));
-			if (size > 4)
-				dmi_write(target, DMI_SBDATA1,
-						((uint32_t) p[4]) |
-						(((uint32_t) p[5]) << 8) |
-						(((uint32_t) p[6]) << 16) |
-						(((uint32_t) p[7]) << 24));
-			uint32_t value = p[0];
-			if (size > 2) {
-				value |= ((uint32_t) p[2]) << 16;
-				value |= ((uint32_t) p[3]) << 24;
+		/* Queue the sbdata writes in batches, each ending with a read of
+		 * sbcs that tells whether DMI or the bus was busy. */
+		bool retry = false;
+		uint32_t i = (next_address - address) / size;
+		while (i < count && !retry) {
+			struct riscv_batch *batch = riscv_batch_alloc(target, SB_BATCH_SCANS,
+					info->dmi_busy_delay + info->bus_master_write_delay);
+			uint32_t batch_end = MIN(count, i + sb_batch_words(size));
+
+			for (; i < batch_end; i++) {
+				const uint8_t *p = buffer + i * size;
+				if (size > 12)
+					riscv_batch_add_dmi_write(batch, DMI_SBDATA3,
+							((uint32_t) p[12]) |
+							(((uint32_t) p[13]) << 8) |
+							(((uint32_t) p[14]) << 16) |
+							(((uint32_t) p[15]) << 24));
+				if (size > 8)
+					riscv_batch_add_dmi_write(batch, DMI_SBDATA2,
+							((uint32_t) p[8]) |
+							(((uint32_t) p[9]) << 8) |
+							(((uint32_t) p[10]) << 16) |
+							(((uint32_t) p[11]) << 24));
+				if (size > 4)
+					riscv_batch_add_dmi_write(batch, DMI_SBDATA1,
+							((uint32_t) p[4]) |
+							(((uint32_t) p[5]) << 8) |
+							(((uint32_t) p[6]) << 16) |
+							(((uint32_t) p[7]) << 24));
+				uint32_t value = p[0];
+				if (size > 2) {
+					value |= ((uint32_t) p[2]) << 16;
+					value |= ((uint32_t) p[3]) << 24;
+				}
+				if (size > 1)
+					value |= ((uint32_t) p[1]) << 8;
+				riscv_batch_add_dmi_write(batch, DMI_SBDATA0, value);
+
+				log_memory_access(address + i * size, value, size, false);
 			}
-			if (size > 1)
-				value |= ((uint32_t) p[1]) << 8;
-			dmi_write(target, DMI_SBDATA0, value);
 
-			log_memory_access(address + i * size, value, size, false);
+			size_t key = riscv_batch_add_dmi_read(batch, DMI_SBCS);
 
-			if (info->bus_master_write_delay) {
-				jtag_add_runtest(info->bus_master_write_delay, TAP_IDLE);
-				if (jtag_execute_queue() != ERROR_OK) {
-					LOG_ERROR("Failed to scan idle sequence");
-					return ERROR_FAIL;
-				}
+			if (batch_run(target, batch) != ERROR_OK) {
+				riscv_batch_free(batch);
+				return ERROR_FAIL;
+			}
+
+			uint64_t dmi_out = riscv_batch_get_dmi_read(batch, key);
+			riscv_batch_free(batch);
+
+			dmi_status_t status = get_field(dmi_out, DTM_DMI_OP);
+			if (status == DMI_STATUS_BUSY) {
+				/* Some writes were dropped. The bus address tells how far
+				 * we got. */
+				increase_dmi_busy_delay(target);
+				retry = true;
+			} else if (status != DMI_STATUS_SUCCESS) {
+				LOG_ERROR("Failed system bus write at 0x%" TARGET_PRIxADDR
+						"; status=%d", address + i * size, status);
+				return ERROR_FAIL;
+			} else if (get_field(dmi_out, DTM_DMI_DATA) &
+					(DMI_SBCS_SBBUSYERROR | DMI_SBCS_SBERROR)) {
+				/* Handled below, once the bus is idle. */
+				break;
 			}
 		}
 
@@ -2556,18 +2666,23 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 			dmi_write(target, DMI_SBCS, DMI_SBCS_SBBUSYERROR);
 			next_address = sb_read_address(target);
 			info->bus_master_write_delay += info->bus_master_write_delay / 10 + 1;
+			LOG_DEBUG("sbbusyerror, bus_master_write_delay=%d",
+					info->bus_master_write_delay);
 			continue;
 		}
 
 		unsigned error = get_field(sbcs, DMI_SBCS_SBERROR);
-		if (error == 0) {
-			next_address = end_address;
-		} else {
+		if (error != 0) {
 			/* Some error indicating the bus access failed, but not because of
 			 * something we did wrong. */
 			dmi_write(target, DMI_SBCS, DMI_SBCS_SBERROR);
 			return ERROR_FAIL;
 		}
+
+		if (retry)
+			next_address = sb_read_address(target);
+		else
+			next_address = end_address;
 	}
 
 	return ERROR_OK;
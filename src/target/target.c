@@ -55,6 +55,7 @@
 #include "rtos/rtos.h"
 #include "transport/transport.h"
 #include "arm_cti.h"
+#include "mem_cache.h"
 
 /* default halt wait timeout (ms) */
 #define DEFAULT_HALT_TIMEOUT 5000
@@ -72,8 +73,6 @@ static int target_get_gdb_fileio_info_default(struct target *target,
 		struct gdb_fileio_info *fileio_info);
 static int target_gdb_fileio_end_default(struct target *target, int retcode,
 		int fileio_errno, bool ctrl_c);
-static int target_profiling_default(struct target *target, uint32_t *samples,
-		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds);
 
 /* targets */
 extern struct target_type arm7tdmi_target;
@@ -898,6 +897,271 @@ done:
 	return retval;
 }
 
+/* Host side work registered with target_register_flash_async_idle_work(). */
+struct flash_async_idle_work {
+	bool (*work)(void *priv);
+	void *priv;
+	struct flash_async_idle_work *next;
+};
+
+static struct flash_async_idle_work *flash_async_idle_works;
+
+/* State of one target_run_flash_async_algorithm() feeding its FIFO. */
+struct flash_async_xfer {
+	struct target *target;
+	const uint8_t *buffer;
+	const uint8_t *buffer_orig;
+	uint32_t count;
+	int block_size;
+
+	uint32_t wp_addr;
+	uint32_t rp_addr;
+	uint32_t fifo_start_addr;
+	uint32_t fifo_end_addr;
+	uint32_t wp;
+	/* read pointer as last polled; the target only ever advances it, so
+	 * the room it leaves is a lower bound until the next poll */
+	uint32_t rp;
+
+	/* estimated drain rate of the algorithm, bytes/ms; 0 if unknown */
+	double drain_rate;
+	/* time of the last read pointer poll, and how long one takes */
+	int64_t poll_ms;
+	int64_t poll_rtt_ms;
+	/* write at least this much per poll, if the data is there */
+	uint32_t chunk;
+
+	/* statistics */
+	int64_t start_ms;
+	int64_t stall_start_ms;
+	int64_t stall_ms;
+	unsigned int polls;
+	unsigned int writes;
+
+	/* give up if the FIFO stays full past this time */
+	int64_t deadline;
+	bool timed_out;
+	bool done;
+	int retval;
+
+	struct flash_async_xfer *next;
+};
+
+/* Transfers in progress. There is more than one only when idle work starts
+ * a flash write of its own; every one of them is then fed while any of them
+ * waits for room in its FIFO. */
+static struct flash_async_xfer *flash_async_xfers;
+
+/* A FIFO that stays full this long means the algorithm is stuck. */
+#define FLASH_ASYNC_TIMEOUT_MS	5000
+
+int target_register_flash_async_idle_work(bool (*work)(void *priv), void *priv)
+{
+	struct flash_async_idle_work **p = &flash_async_idle_works;
+
+	if (work == NULL)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	while (*p)
+		p = &(*p)->next;
+
+	*p = malloc(sizeof(struct flash_async_idle_work));
+	if (*p == NULL)
+		return ERROR_FAIL;
+
+	(*p)->work = work;
+	(*p)->priv = priv;
+	(*p)->next = NULL;
+
+	return ERROR_OK;
+}
+
+int target_unregister_flash_async_idle_work(bool (*work)(void *priv), void *priv)
+{
+	for (struct flash_async_idle_work **p = &flash_async_idle_works; *p; p = &(*p)->next) {
+		struct flash_async_idle_work *w = *p;
+		if (w->work == work && w->priv == priv) {
+			*p = w->next;
+			free(w);
+			return ERROR_OK;
+		}
+	}
+
+	return ERROR_FAIL;
+}
+
+/* Run one piece of registered idle work; false if there was none. The
+ * work may itself run flash algorithms and register or unregister work,
+ * so the list isn't touched after a call that did something. */
+static bool flash_async_run_idle_work(void)
+{
+	for (struct flash_async_idle_work *w = flash_async_idle_works; w; w = w->next) {
+		if (w->work(w->priv))
+			return true;
+	}
+
+	return false;
+}
+
+/* Room for data from wp up to the cached read pointer or the end of the
+ * FIFO, whichever comes first. Never fills the FIFO completely, because
+ * that would make wp == rp and that's the empty condition. */
+static uint32_t flash_async_room(const struct flash_async_xfer *x)
+{
+	if (x->rp > x->wp)
+		return x->rp - x->wp - x->block_size;
+	else if (x->rp > x->fifo_start_addr)
+		return x->fifo_end_addr - x->wp;
+	else
+		return x->fifo_end_addr - x->wp - x->block_size;
+}
+
+/* Read the read pointer and update the drain rate estimate. */
+static int flash_async_poll(struct flash_async_xfer *x)
+{
+	uint32_t fifo_size = x->fifo_end_addr - x->fifo_start_addr;
+	int64_t start = timeval_ms();
+	uint32_t rp;
+
+	int retval = target_read_u32(x->target, x->rp_addr, &rp);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("failed to get read pointer");
+		return retval;
+	}
+
+	int64_t now = timeval_ms();
+	x->polls++;
+	x->poll_rtt_ms = (x->poll_rtt_ms * 3 + (now - start)) / 4;
+
+	LOG_DEBUG("offs 0x%zx count 0x%" PRIx32 " wp 0x%" PRIx32 " rp 0x%" PRIx32,
+		(size_t) (x->buffer - x->buffer_orig), x->count, x->wp, rp);
+
+	if (rp == 0) {
+		LOG_ERROR("flash write algorithm aborted by target");
+		return ERROR_FLASH_OPERATION_FAILED;
+	}
+
+	if (((rp - x->fifo_start_addr) & (x->block_size - 1)) || rp < x->fifo_start_addr
+			|| rp >= x->fifo_end_addr) {
+		LOG_ERROR("corrupted fifo read pointer 0x%" PRIx32, rp);
+		return ERROR_FLASH_OPERATION_FAILED;
+	}
+
+	/* Only a FIFO that is still not empty tells how fast the target
+	 * drains it; otherwise it may have been idle part of the time. */
+	uint32_t drained = (rp - x->rp + fifo_size) % fifo_size;
+	if (rp != x->wp && drained && now > x->poll_ms) {
+		double sample = (double)drained / (now - x->poll_ms);
+		x->drain_rate = x->drain_rate ? (x->drain_rate * 3 + sample) / 4 : sample;
+	}
+	x->poll_ms = now;
+	x->rp = rp;
+
+	/* Polling again before the target has drained what it can during
+	 * one poll is a wasted round trip, so aim to write at least that. */
+	uint32_t chunk = x->drain_rate * MAX(x->poll_rtt_ms, 1);
+	chunk = MIN(chunk, fifo_size / 2);
+	chunk &= ~(x->block_size - 1);
+	x->chunk = MAX(chunk, (uint32_t)x->block_size);
+
+	return ERROR_OK;
+}
+
+/* Write as much data as the FIFO has room for, polling the read pointer
+ * only if the room known from the last poll is less than a chunk.
+ * Returns true if data was written. */
+static bool flash_async_xfer_step(struct flash_async_xfer *x)
+{
+	int retval;
+
+	uint32_t thisrun_bytes = flash_async_room(x);
+	if (thisrun_bytes < MIN(x->chunk, x->count * x->block_size)) {
+		retval = flash_async_poll(x);
+		if (retval != ERROR_OK)
+			goto fail;
+		thisrun_bytes = flash_async_room(x);
+	}
+
+	if (thisrun_bytes == 0) {
+		if (!x->stall_start_ms)
+			x->stall_start_ms = timeval_ms();
+
+		/* to stop an infinite loop on some targets check the time since
+		 * the last progress; this issue was observed on a stellaris using
+		 * the new ICDI interface */
+		if (timeval_ms() > x->deadline) {
+			LOG_ERROR("timeout waiting for algorithm, a target reset is recommended");
+			x->timed_out = true;
+			x->retval = ERROR_FLASH_OPERATION_FAILED;
+			x->done = true;
+		}
+		return false;
+	}
+
+	/* reset our timeout */
+	x->deadline = timeval_ms() + FLASH_ASYNC_TIMEOUT_MS;
+	if (x->stall_start_ms) {
+		x->stall_ms += timeval_ms() - x->stall_start_ms;
+		x->stall_start_ms = 0;
+	}
+
+	/* Limit to the amount of data we actually want to write */
+	if (thisrun_bytes > x->count * x->block_size)
+		thisrun_bytes = x->count * x->block_size;
+
+	/* Write data to fifo */
+	retval = target_write_buffer(x->target, x->wp, thisrun_bytes, x->buffer);
+	if (retval != ERROR_OK)
+		goto fail;
+
+	/* Update counters and wrap write pointer */
+	x->buffer += thisrun_bytes;
+	x->count -= thisrun_bytes / x->block_size;
+	x->wp += thisrun_bytes;
+	if (x->wp >= x->fifo_end_addr)
+		x->wp = x->fifo_start_addr;
+
+	/* Store updated write pointer to target */
+	retval = target_write_u32(x->target, x->wp_addr, x->wp);
+	if (retval != ERROR_OK)
+		goto fail;
+
+	x->writes++;
+	if (x->count == 0)
+		x->done = true;
+
+	return true;
+
+fail:
+	x->retval = retval;
+	x->done = true;
+	return false;
+}
+
+/* How long to sleep until the target should have drained a chunk. */
+static int flash_async_sleep_ms(const struct flash_async_xfer *x)
+{
+	if (!x->drain_rate)
+		return 10;
+
+	return MIN(MAX((int)(x->chunk / x->drain_rate), 1), 10);
+}
+
+/* Feed every other transfer in progress once; true if any made progress. */
+static bool flash_async_step_others(struct flash_async_xfer *self)
+{
+	bool progress = false;
+
+	for (struct flash_async_xfer *x = flash_async_xfers; x; x = x->next) {
+		if (x == self || x->done)
+			continue;
+		if (flash_async_xfer_step(x))
+			progress = true;
+	}
+
+	return progress;
+}
+
 /**
  * Streams data to a circular buffer on target intended for consumption by code
  * running asynchronously on target.
@@ -948,27 +1212,35 @@ int target_run_flash_async_algorithm(struct target *target,
 		uint32_t entry_point, uint32_t exit_point, void *arch_info)
 {
 	int retval;
-	int timeout = 0;
-
-	const uint8_t *buffer_orig = buffer;
 
 	/* Set up working area. First word is write pointer, second word is read pointer,
 	 * rest is fifo data area. */
-	uint32_t wp_addr = buffer_start;
-	uint32_t rp_addr = buffer_start + 4;
-	uint32_t fifo_start_addr = buffer_start + 8;
-	uint32_t fifo_end_addr = buffer_start + buffer_size;
-
-	uint32_t wp = fifo_start_addr;
-	uint32_t rp = fifo_start_addr;
+	struct flash_async_xfer x = {
+		.target = target,
+		.buffer = buffer,
+		.buffer_orig = buffer,
+		.count = count,
+		.block_size = block_size,
+		.wp_addr = buffer_start,
+		.rp_addr = buffer_start + 4,
+		.fifo_start_addr = buffer_start + 8,
+		.fifo_end_addr = buffer_start + buffer_size,
+		.wp = buffer_start + 8,
+		.rp = buffer_start + 8,
+		.chunk = block_size,
+		.deadline = timeval_ms() + FLASH_ASYNC_TIMEOUT_MS,
+		.done = count == 0,
+		.retval = ERROR_OK,
+	};
+	uint32_t rp = x.rp;
 
 	/* validate block_size is 2^n */
 	assert(!block_size || !(block_size & (block_size - 1)));
 
-	retval = target_write_u32(target, wp_addr, wp);
+	retval = target_write_u32(target, x.wp_addr, x.wp);
 	if (retval != ERROR_OK)
 		return retval;
-	retval = target_write_u32(target, rp_addr, rp);
+	retval = target_write_u32(target, x.rp_addr, rp);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -984,86 +1256,51 @@ int target_run_flash_async_algorithm(struct target *target,
 		return retval;
 	}
 
-	while (count > 0) {
-
-		retval = target_read_u32(target, rp_addr, &rp);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("failed to get read pointer");
-			break;
-		}
-
-		LOG_DEBUG("offs 0x%zx count 0x%" PRIx32 " wp 0x%" PRIx32 " rp 0x%" PRIx32,
-			(size_t) (buffer - buffer_orig), count, wp, rp);
-
-		if (rp == 0) {
-			LOG_ERROR("flash write algorithm aborted by target");
-			retval = ERROR_FLASH_OPERATION_FAILED;
-			break;
-		}
-
-		if (((rp - fifo_start_addr) & (block_size - 1)) || rp < fifo_start_addr || rp >= fifo_end_addr) {
-			LOG_ERROR("corrupted fifo read pointer 0x%" PRIx32, rp);
-			break;
-		}
-
-		/* Count the number of bytes available in the fifo without
-		 * crossing the wrap around. Make sure to not fill it completely,
-		 * because that would make wp == rp and that's the empty condition. */
-		uint32_t thisrun_bytes;
-		if (rp > wp)
-			thisrun_bytes = rp - wp - block_size;
-		else if (rp > fifo_start_addr)
-			thisrun_bytes = fifo_end_addr - wp;
-		else
-			thisrun_bytes = fifo_end_addr - wp - block_size;
-
-		if (thisrun_bytes == 0) {
-			/* Throttle polling a bit if transfer is (much) faster than flash
-			 * programming. The exact delay shouldn't matter as long as it's
-			 * less than buffer size / flash speed. This is very unlikely to
-			 * run when using high latency connections such as USB. */
-			alive_sleep(10);
-
-			/* to stop an infinite loop on some targets check and increment a timeout
-			 * this issue was observed on a stellaris using the new ICDI interface */
-			if (timeout++ >= 500) {
-				LOG_ERROR("timeout waiting for algorithm, a target reset is recommended");
-				return ERROR_FLASH_OPERATION_FAILED;
+	x.start_ms = timeval_ms();
+	x.poll_ms = x.start_ms;
+	x.next = flash_async_xfers;
+	flash_async_xfers = &x;
+
+	while (!x.done) {
+		if (!flash_async_xfer_step(&x) && !x.done) {
+			/* Our FIFO is full. Feed the other transfers, then use the
+			 * time for any pending host side work. */
+			if (!flash_async_step_others(&x) && !flash_async_run_idle_work()) {
+				/* Throttle polling if transfer is (much) faster than flash
+				 * programming, for about as long as the target needs to
+				 * drain a chunk once its rate is known. This is very
+				 * unlikely to run when using high latency connections
+				 * such as USB. */
+				alive_sleep(flash_async_sleep_ms(&x));
 			}
-			continue;
 		}
 
-		/* reset our timeout */
-		timeout = 0;
-
-		/* Limit to the amount of data we actually want to write */
-		if (thisrun_bytes > count * block_size)
-			thisrun_bytes = count * block_size;
+		/* Avoid GDB timeouts */
+		keep_alive();
+	}
 
-		/* Write data to fifo */
-		retval = target_write_buffer(target, wp, thisrun_bytes, buffer);
-		if (retval != ERROR_OK)
+	/* transfers are nested, so ours is the most recent one still listed */
+	for (struct flash_async_xfer **p = &flash_async_xfers; *p; p = &(*p)->next) {
+		if (*p == &x) {
+			*p = x.next;
 			break;
+		}
+	}
 
-		/* Update counters and wrap write pointer */
-		buffer += thisrun_bytes;
-		count -= thisrun_bytes / block_size;
-		wp += thisrun_bytes;
-		if (wp >= fifo_end_addr)
-			wp = fifo_start_addr;
-
-		/* Store updated write pointer to target */
-		retval = target_write_u32(target, wp_addr, wp);
-		if (retval != ERROR_OK)
-			break;
+	if (x.timed_out)
+		return x.retval;
 
-		/* Avoid GDB timeouts */
-		keep_alive();
-	}
+	int64_t elapsed_ms = timeval_ms() - x.start_ms;
+	uint32_t sent = x.buffer - x.buffer_orig;
+	LOG_DEBUG("async flash algorithm: %" PRIu32 " bytes in %" PRId64 " ms (%0.3f KiB/s), "
+		"stalled %" PRId64 " ms, drain rate %0.3f KiB/s, %u polls, %u writes",
+		sent, elapsed_ms, elapsed_ms ? sent / 1.024 / elapsed_ms : 0.0,
+		x.stall_ms, x.drain_rate / 1.024, x.polls, x.writes);
 
+	retval = x.retval;
 	if (retval != ERROR_OK) {
 		/* abort flash write algorithm on target */
-		target_write_u32(target, wp_addr, 0);
+		target_write_u32(target, x.wp_addr, 0);
 	}
 
 	int retval2 = target_wait_algorithm(target, num_mem_params, mem_params,
@@ -1079,7 +1316,7 @@ int target_run_flash_async_algorithm(struct target *target,
 
 	if (retval == ERROR_OK) {
 		/* check if algorithm set rp = 0 after fifo writer loop finished */
-		retval = target_read_u32(target, rp_addr, &rp);
+		retval = target_read_u32(target, x.rp_addr, &rp);
 		if (retval == ERROR_OK && rp == 0) {
 			LOG_ERROR("flash write algorithm aborted by target");
 			retval = ERROR_FLASH_OPERATION_FAILED;
@@ -1128,6 +1365,8 @@ int target_write_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	mem_cache_invalidate_range(target, address, size * count);
+	rtos_invalidate_thread_regs(target);
 	return target->type->write_memory(target, address, size, count, buffer);
 }
 
@@ -1142,6 +1381,9 @@ int target_write_phys_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_phys_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	/* the cache holds virtual addresses; no telling what aliases this */
+	mem_cache_invalidate(target);
+	rtos_invalidate_thread_regs(target);
 	return target->type->write_phys_memory(target, address, size, count, buffer);
 }
 
@@ -1256,6 +1498,7 @@ bool target_supports_gdb_connection(struct target *target)
 int target_step(struct target *target,
 		int current, target_addr_t address, int handle_breakpoints)
 {
+	mem_cache_invalidate(target);
 	return target->type->step(target, current, address, handle_breakpoints);
 }
 
@@ -1722,6 +1965,21 @@ int target_call_timer_callbacks_now(void)
 	return target_call_timer_callbacks_check_time(0);
 }
 
+int target_timer_next_event(struct timeval *when)
+{
+	bool found = false;
+
+	for (struct target_timer_callback *cb = target_timer_callbacks; cb; cb = cb->next) {
+		if (cb->removed || !cb->callback)
+			continue;
+		if (!found || timeval_compare(&cb->when, when) < 0)
+			*when = cb->when;
+		found = true;
+	}
+
+	return found ? ERROR_OK : ERROR_FAIL;
+}
+
 /* Prints the working area layout for debug purposes */
 static void print_wa_layout(struct target *target)
 {
@@ -2050,6 +2308,7 @@ static void target_destroy(struct target *target)
 	}
 
 	rtos_destroy(target);
+	mem_cache_free(target);
 
 	free(target->gdb_port_override);
 	free(target->type);
@@ -2119,7 +2378,7 @@ static int target_gdb_fileio_end_default(struct target *target,
 	return ERROR_OK;
 }
 
-static int target_profiling_default(struct target *target, uint32_t *samples,
+int target_profiling_default(struct target *target, uint32_t *samples,
 		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
 {
 	struct timeval timeout, now;
@@ -2192,6 +2451,8 @@ int target_write_buffer(struct target *target, target_addr_t address, uint32_t s
 		return ERROR_FAIL;
 	}
 
+	mem_cache_invalidate_range(target, address, size);
+	rtos_invalidate_thread_regs(target);
 	return target->type->write_buffer(target, address, size, buffer);
 }
 
@@ -2951,6 +3212,8 @@ COMMAND_HANDLER(handle_reg_command)
 		str_to_buf(CMD_ARGV[1], strlen(CMD_ARGV[1]), buf, reg->size, 0);
 
 		reg->type->set(reg, buf);
+		/* may remap memory, e.g. an MMU or bank control register */
+		mem_cache_invalidate(target);
 
 		value = buf_to_str(reg->value, reg->size, 16);
 		command_print(CMD, "%s (/%i): 0x%s", reg->name, (int)(reg->size), value);
@@ -5384,6 +5647,9 @@ static const struct command_registration target_instance_command_handlers[] = {
 		.help = "invoke handler for specified event",
 		.usage = "event_name",
 	},
+	{
+		.chain = mem_cache_command_handlers,
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -212,6 +212,9 @@ struct target {
 
 	/* The semihosting information, extracted from the target. */
 	struct semihosting *semihosting;
+
+	/* Cached memory contents while halted, see mem_cache.h */
+	struct mem_cache *mem_cache;
 };
 
 struct target_list {
@@ -383,6 +386,14 @@ int target_poll(struct target *target);
 int target_resume(struct target *target, int current, target_addr_t address,
 		int handle_breakpoints, int debug_execution);
 int target_halt(struct target *target);
+
+/**
+ * Generic profiling fallback: halt the target, record the PC and resume,
+ * as often as possible for @a seconds.  Targets with a non-intrusive PC
+ * sampling register fall back to this when the register is absent.
+ */
+int target_profiling_default(struct target *target, uint32_t *samples,
+		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds);
 int target_call_event_callbacks(struct target *target, enum target_event event);
 int target_call_reset_callbacks(struct target *target, enum target_reset_mode reset_mode);
 int target_call_trace_callbacks(struct target *target, size_t len, uint8_t *data);
@@ -400,6 +411,11 @@ int target_call_timer_callbacks(void);
  * a synchronous command completes.
  */
 int target_call_timer_callbacks_now(void);
+/**
+ * Find the time at which the earliest pending timer callback is due.
+ * Returns ERROR_FAIL if no timer callbacks are registered.
+ */
+int target_timer_next_event(struct timeval *when);
 
 struct target *get_target_by_num(int num);
 struct target *get_current_target(struct command_context *cmd_ctx);
@@ -572,6 +588,16 @@ int target_run_flash_async_algorithm(struct target *target,
 		uint32_t entry_point, uint32_t exit_point,
 		void *arch_info);
 
+/**
+ * Register host side work to do while target_run_flash_async_algorithm()
+ * waits for the target to make room in its FIFO, instead of sleeping.
+ * @a work is called repeatedly and returns false once it has nothing left
+ * to do. It may run flash algorithms on other targets itself; the FIFOs of
+ * all transfers in progress are fed while any of them waits.
+ */
+int target_register_flash_async_idle_work(bool (*work)(void *priv), void *priv);
+int target_unregister_flash_async_idle_work(bool (*work)(void *priv), void *priv);
+
 /**
  * Read @a count items of @a size bytes from the memory of @a target at
  * the @a address given.